@@ -0,0 +1,17 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/spdlog-populate"
+  "CMakeFiles/spdlog-populate-complete"
+  "spdlog-populate-prefix/src/spdlog-populate-stamp/spdlog-populate-build"
+  "spdlog-populate-prefix/src/spdlog-populate-stamp/spdlog-populate-configure"
+  "spdlog-populate-prefix/src/spdlog-populate-stamp/spdlog-populate-download"
+  "spdlog-populate-prefix/src/spdlog-populate-stamp/spdlog-populate-install"
+  "spdlog-populate-prefix/src/spdlog-populate-stamp/spdlog-populate-mkdir"
+  "spdlog-populate-prefix/src/spdlog-populate-stamp/spdlog-populate-patch"
+  "spdlog-populate-prefix/src/spdlog-populate-stamp/spdlog-populate-test"
+  "spdlog-populate-prefix/src/spdlog-populate-stamp/spdlog-populate-update"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang )
+  include(CMakeFiles/spdlog-populate.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
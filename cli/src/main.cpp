@@ -1,121 +1,179 @@
-#include <cstring>
-
-#include <cerrno>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <filesystem>
+#include <fstream>
 #include <functional>
 #include <iostream>
-#include <sys/socket.h>
-#include <sys/un.h>
-#include <unistd.h>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 #include "CLI/CLI.hpp"
 #include "spdlog/fmt/bundled/format.h"
 
+#include "openskydimo/client.hpp"
 #include "openskydimo/commands.hpp"
-#include "openskydimo/config.h"
+#include "openskydimo/stats.hpp"
+
+using openskydimo::stats::Percentile;
 
 bool SendCommand(const std::string& command)
 {
-    // RAII wrapper for socket file descriptor
-    struct SocketGuard
-    {
-        int fd;
-        explicit SocketGuard(const int fd_) : fd(fd_)
-        {
-        }
+    openskydimo::client::Connection connection;
 
-        ~SocketGuard()
-        {
-            if (fd >= 0)
-                close(fd);
-        }
-
-        SocketGuard(const SocketGuard&) = delete;
-        SocketGuard& operator=(const SocketGuard&) = delete;
-        explicit operator int() const
-        {
-            return fd;
-        }
-    };
-
-    const SocketGuard sockFd(socket(AF_UNIX, SOCK_STREAM, 0));
+    if (!connection.Connect())
+    {
+        std::cerr << connection.GetError() << std::endl;
+        return false;
+    }
 
-    if (static_cast<int>(sockFd) < 0)
+    if (!connection.SendLine(command))
     {
-        std::cerr << "Failed to create socket" << std::endl;
+        std::cerr << connection.GetError() << std::endl;
         return false;
     }
 
-    sockaddr_un addr{};
-    addr.sun_family = AF_UNIX;
-    strncpy(addr.sun_path, s_socketPath.c_str(), sizeof(addr.sun_path) - 1);
+    connection.FinishSending();
 
-    if (connect(static_cast<int>(sockFd), reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0)
+    if (std::string response; connection.ReadLine(response))
+    {
+        std::cout << "[SERVER] - " << response << std::endl;
+    }
+    else if (!connection.GetError().empty())
     {
-        std::cerr << "Failed to connect (is daemon running?)" << std::endl;
+        std::cerr << connection.GetError() << std::endl;
         return false;
     }
 
-    const std::string msg = command + "\n";
-    size_t totalWritten = 0;
-    const size_t msgLen = msg.length();
+    return true;
+}
+
+// Streams commands (one per line) over a single connection. Commands are pipelined: a reader
+// thread collects responses while the next commands are still being sent. With a rate, command
+// N is sent at start + N / rate rather than as fast as possible.
+int RunBatch(std::istream& input, const double rate)
+{
+    using Clock = std::chrono::steady_clock;
 
-    while (totalWritten < msgLen)
+    struct PendingCommand
     {
-        const ssize_t bytesWritten = write(static_cast<int>(sockFd), msg.c_str() + totalWritten, msgLen - totalWritten);
+        size_t lineNumber;
+        std::string command;
+        Clock::time_point sentAt;
+    };
 
-        if (bytesWritten < 0)
-        {
-            std::cerr << "Write error: " << strerror(errno) << std::endl;
-            return false;
-        }
+    openskydimo::client::Connection connection;
 
-        if (bytesWritten == 0)
+    if (!connection.Connect())
+    {
+        std::cerr << connection.GetError() << std::endl;
+        return 1;
+    }
+
+    std::mutex pendingMutex;
+    std::deque<PendingCommand> pending;
+    std::vector<double> latenciesMs;
+    size_t errorCount = 0;
+    std::atomic<bool> isReaderDone = false;
+    bool isOutOfSync = false;
+
+    std::thread reader([&] {
+        std::string response;
+
+        while (connection.ReadLine(response))
         {
-            std::cerr << "Write returned 0 (connection closed?)" << std::endl;
-            return false;
+            const auto receivedAt = Clock::now();
+            PendingCommand command;
+            {
+                std::lock_guard lock(pendingMutex);
+
+                if (pending.empty())
+                {
+                    std::cerr << "Unexpected response with no command pending: " << response << std::endl;
+                    isOutOfSync = true;
+                    break;
+                }
+
+                command = std::move(pending.front());
+                pending.pop_front();
+            }
+
+            latenciesMs.push_back(std::chrono::duration<double, std::milli>(receivedAt - command.sentAt).count());
+
+            if (response.starts_with("ERROR"))
+                ++errorCount;
+
+            if (response != "OK")
+                std::cout << "[SERVER] line " << command.lineNumber << " (" << command.command << ") - " << response
+                          << std::endl;
         }
 
-        totalWritten += static_cast<size_t>(bytesWritten);
-    }
+        // Nothing reads responses from here on, so once the daemon's output cap fills it stops
+        // reading commands too. Stop the sender rather than let it block forever.
+        isReaderDone = true;
+        connection.Shutdown();
+    });
 
-    // Read response with loop to handle chunked data
-    std::string response;
-    char buffer[128];
-    bool receivedData = false;
+    const auto startTime = Clock::now();
+    size_t sentCount = 0;
+    size_t lineNumber = 0;
+    std::string line;
+    bool isSendOk = true;
 
-    while (true)
+    while (isSendOk && !isReaderDone && std::getline(input, line))
     {
-        const ssize_t bytesRead = read(static_cast<int>(sockFd), buffer, sizeof(buffer) - 1);
+        ++lineNumber;
+
+        const auto first = line.find_first_not_of(" \t\r");
 
-        if (bytesRead < 0)
+        if (first == std::string::npos || line[first] == '#')
+            continue;
+
+        line.erase(0, first);
+        while (!line.empty() && (line.back() == '\r' || line.back() == ' ' || line.back() == '\t'))
+            line.pop_back();
+
+        if (rate > 0.0)
         {
-            std::cerr << "Read error: " << strerror(errno) << std::endl;
-            return false;
+            const auto offset = std::chrono::duration<double>(static_cast<double>(sentCount) / rate);
+            std::this_thread::sleep_until(startTime + std::chrono::duration_cast<Clock::duration>(offset));
         }
 
-        if (bytesRead == 0)
-            break; // EOF - server closed connection
-
-        receivedData = true;
-        buffer[bytesRead] = '\0';
-        response.append(buffer, static_cast<size_t>(bytesRead));
+        {
+            // Queue before sending so the reader can never see a response it has no entry for
+            std::lock_guard lock(pendingMutex);
+            pending.push_back({lineNumber, line, Clock::now()});
+        }
 
-        // If response contains newline, assume message is complete
-        if (response.find('\n') != std::string::npos)
-            break;
+        isSendOk = connection.SendLine(line);
+        ++sentCount;
     }
 
-    if (receivedData)
+    if (!isSendOk)
+        std::cerr << connection.GetError() << std::endl;
+
+    connection.FinishSending();
+    reader.join();
+
+    const double elapsedSeconds = std::chrono::duration<double>(Clock::now() - startTime).count();
+    const size_t lostCount = pending.size();
+
+    std::ranges::sort(latenciesMs);
+
+    std::cerr << fmt::format("{} commands in {:.3f} s ({:.0f} commands/s), {} errors, {} without response\n",
+                             sentCount, elapsedSeconds, static_cast<double>(sentCount) / elapsedSeconds,
+                             errorCount, lostCount);
+
+    if (!latenciesMs.empty())
     {
-        std::cout << "[SERVER] - " << response;
-        // Ensure output ends with newline if server didn't provide one
-        if (!response.empty() && response.back() != '\n')
-        {
-            std::cout << std::endl;
-        }
+        std::cerr << fmt::format("latency ms: min {:.3f}  p50 {:.3f}  p90 {:.3f}  p99 {:.3f}  max {:.3f}\n",
+                                 latenciesMs.front(), Percentile(latenciesMs, 0.50), Percentile(latenciesMs, 0.90),
+                                 Percentile(latenciesMs, 0.99), latenciesMs.back());
     }
 
-    return true;
+    return isSendOk && !isOutOfSync && errorCount == 0 && lostCount == 0 ? 0 : 1;
 }
 
 std::string JoinArgs(const int argc, char* argv[])
@@ -148,10 +206,61 @@ int main(const int argc, char* argv[])
     const auto setCmd = AddSetCmd(&app);
     AddSetPortCmd(setCmd, [&] { SendCommand(cmd); }, cmdArgs.serialPort);
     AddSetCountCmd(setCmd, [&] { SendCommand(cmd); }, cmdArgs.ledCount);
+    AddSetOrderCmd(setCmd, [&] { SendCommand(cmd); }, cmdArgs.colorOrder);
 
     AddStartCmd(&app, [&] { SendCommand(cmd); });
     AddStopCmd(&app, [&] { SendCommand(cmd); });
+    AddStatusCmd(&app, [&] { SendCommand(cmd); });
+    AddFrameCmd(&app, [&] { SendCommand(cmd); }, cmdArgs.pixelFormat, cmdArgs.pixelData);
+
+    // The daemon runs in its own working directory, so capture paths are resolved against ours first
+    const auto recordCmd = AddRecordCmd(&app);
+    AddRecordStartCmd(
+        recordCmd,
+        [&] {
+            SendCommand(fmt::format("record start \"{}\"", std::filesystem::absolute(cmdArgs.recordPath).string()));
+        },
+        cmdArgs.recordPath);
+    AddRecordStopCmd(recordCmd, [&] { SendCommand(cmd); });
+
+    const auto replayCmd = AddReplayCmd(&app);
+    AddReplayStartCmd(
+        replayCmd,
+        [&] {
+            SendCommand(fmt::format("replay start \"{}\" --rate {}",
+                                    std::filesystem::absolute(cmdArgs.replayPath).string(), cmdArgs.replayRate));
+        },
+        cmdArgs.replayPath, cmdArgs.replayRate);
+    AddReplayStopCmd(replayCmd, [&] { SendCommand(cmd); });
+
+    std::string batchFile;
+    bool useStdin = false;
+    double rate = 0.0;
+
+    const auto batchOpt = app.add_option("--batch", batchFile, "Send every command in a file over one connection")
+                              ->check(CLI::ExistingFile);
+    app.add_flag("--stdin", useStdin, "Send commands read from stdin over one connection")->excludes(batchOpt);
+    const auto rateOpt =
+        app.add_option("--rate", rate, "Commands per second for --batch/--stdin (default: as fast as possible)")
+            ->check(CLI::PositiveNumber);
+
+    // needs() only takes a single option, so check for either here. This runs before any
+    // subcommand callback, so a rejected command line never sends anything.
+    app.parse_complete_callback([&] {
+        if (rateOpt->count() > 0 && batchFile.empty() && !useStdin)
+            throw CLI::ValidationError("--rate", "only applies with --batch or --stdin");
+    });
 
     CLI11_PARSE(app, argc, argv);
+
+    if (!batchFile.empty())
+    {
+        std::ifstream file(batchFile);
+        return RunBatch(file, rate);
+    }
+
+    if (useStdin)
+        return RunBatch(std::cin, rate);
+
     return 0;
 }
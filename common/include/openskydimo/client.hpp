@@ -0,0 +1,242 @@
+#pragma once
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <cstring>
+#include <poll.h>
+#include <string>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <utility>
+
+#include "openskydimo/config.h"
+
+namespace openskydimo::client
+{
+
+// A connection to the daemon's control socket. Commands and responses are newline-terminated and
+// a connection can carry any number of them; responses arrive in the order commands were sent.
+class Connection
+{
+public:
+    Connection() = default;
+
+    ~Connection()
+    {
+        Close();
+    }
+
+    Connection(const Connection&) = delete;
+    Connection& operator=(const Connection&) = delete;
+
+    Connection(Connection&& other) noexcept
+        : m_fd(std::exchange(other.m_fd, -1)), m_readBuffer(std::move(other.m_readBuffer)),
+          m_error(std::move(other.m_error)), m_errno(other.m_errno)
+    {
+    }
+
+    Connection& operator=(Connection&& other) noexcept
+    {
+        if (this != &other)
+        {
+            Close();
+            m_fd = std::exchange(other.m_fd, -1);
+            m_readBuffer = std::move(other.m_readBuffer);
+            m_error = std::move(other.m_error);
+            m_errno = other.m_errno;
+        }
+
+        return *this;
+    }
+
+    // A non-zero sendTimeout bounds connect() and every later send. A connect that times out, e.g.
+    // because the daemon stopped accepting and its backlog is full, fails with EAGAIN.
+    bool Connect(const std::string& socketPath = s_socketPath,
+                 const std::chrono::milliseconds sendTimeout = std::chrono::milliseconds::zero())
+    {
+        Close();
+
+        m_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+        if (m_fd < 0)
+            return Fail("Failed to create socket");
+
+        if (sendTimeout > std::chrono::milliseconds::zero())
+        {
+            const auto seconds = std::chrono::duration_cast<std::chrono::seconds>(sendTimeout);
+            const timeval timeout{static_cast<time_t>(seconds.count()),
+                                  static_cast<suseconds_t>((sendTimeout - seconds).count() * 1000)};
+
+            if (setsockopt(m_fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout)) < 0)
+            {
+                Fail("Failed to set send timeout");
+                Close();
+                return false;
+            }
+        }
+
+        sockaddr_un addr{};
+        addr.sun_family = AF_UNIX;
+        strncpy(addr.sun_path, socketPath.c_str(), sizeof(addr.sun_path) - 1);
+
+        if (connect(m_fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0)
+        {
+            Fail("Failed to connect (is daemon running?)");
+            Close();
+            return false;
+        }
+
+        return true;
+    }
+
+    void Close()
+    {
+        if (m_fd >= 0)
+            close(m_fd);
+
+        m_fd = -1;
+        m_readBuffer.clear();
+    }
+
+    [[nodiscard]] bool IsConnected() const
+    {
+        return m_fd >= 0;
+    }
+
+    bool SendLine(const std::string& command)
+    {
+        const std::string msg = command + "\n";
+        size_t totalWritten = 0;
+
+        while (totalWritten < msg.size())
+        {
+            // MSG_NOSIGNAL: a daemon that went away should surface as EPIPE, not kill the client
+            const ssize_t bytesWritten =
+                send(m_fd, msg.data() + totalWritten, msg.size() - totalWritten, MSG_NOSIGNAL);
+
+            if (bytesWritten < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                return Fail("Write error");
+            }
+
+            if (bytesWritten == 0)
+            {
+                errno = EPIPE;
+                return Fail("Write returned 0 (connection closed?)");
+            }
+
+            totalWritten += static_cast<size_t>(bytesWritten);
+        }
+
+        return true;
+    }
+
+    // Reads one response without its trailing newline. Returns false on error or once the daemon
+    // has closed the connection and every buffered line has been returned.
+    bool ReadLine(std::string& line)
+    {
+        return ReadLine(line, std::chrono::steady_clock::time_point::max());
+    }
+
+    // As above, but fails with ETIMEDOUT if no complete response has arrived by the deadline
+    bool ReadLine(std::string& line, const std::chrono::steady_clock::time_point deadline)
+    {
+        size_t newline;
+
+        while ((newline = m_readBuffer.find('\n')) == std::string::npos)
+        {
+            if (deadline != std::chrono::steady_clock::time_point::max())
+            {
+                const auto remaining =
+                    std::chrono::ceil<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+
+                if (remaining <= std::chrono::milliseconds::zero())
+                {
+                    errno = ETIMEDOUT;
+                    return Fail("No response");
+                }
+
+                pollfd fd = {m_fd, POLLIN, 0};
+                const auto timeoutMs = std::min<std::chrono::milliseconds::rep>(remaining.count(), INT_MAX);
+                const int ready = poll(&fd, 1, static_cast<int>(timeoutMs));
+
+                if (ready < 0 && errno != EINTR)
+                    return Fail("Poll error");
+
+                // Timed out or interrupted; the deadline check above decides which
+                if (ready <= 0)
+                    continue;
+            }
+
+            char buffer[4096];
+            const ssize_t bytesRead = read(m_fd, buffer, sizeof(buffer));
+
+            if (bytesRead < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                return Fail("Read error");
+            }
+
+            if (bytesRead == 0)
+            {
+                // Hand back an unterminated final response rather than dropping it
+                if (m_readBuffer.empty())
+                    return false;
+
+                line = std::exchange(m_readBuffer, {});
+                return true;
+            }
+
+            m_readBuffer.append(buffer, static_cast<size_t>(bytesRead));
+        }
+
+        line = m_readBuffer.substr(0, newline);
+        m_readBuffer.erase(0, newline + 1);
+        return true;
+    }
+
+    // Tells the daemon no more commands are coming; it closes the connection after the last response
+    void FinishSending()
+    {
+        shutdown(m_fd, SHUT_WR);
+    }
+
+    // Shuts both directions without closing the descriptor, so a send or read blocked on another
+    // thread returns with an error instead of waiting on a daemon that will never catch up
+    void Shutdown()
+    {
+        shutdown(m_fd, SHUT_RDWR);
+    }
+
+    [[nodiscard]] const std::string& GetError() const
+    {
+        return m_error;
+    }
+
+    [[nodiscard]] int GetErrno() const
+    {
+        return m_errno;
+    }
+
+private:
+    bool Fail(const std::string& what)
+    {
+        m_errno = errno;
+        m_error = what + ": " + strerror(m_errno);
+        return false;
+    }
+
+private:
+    int m_fd = -1;
+    std::string m_readBuffer;
+    std::string m_error;
+    int m_errno = 0;
+};
+
+} // namespace openskydimo::client
@@ -15,6 +15,12 @@ struct Args
     ColorRGB fillColor{};
     std::string serialPort;
     uint8_t ledCount{};
+    std::string colorOrder;
+    std::string recordPath;
+    std::string replayPath;
+    double replayRate = 1.0;
+    std::string pixelFormat;
+    std::string pixelData;
 };
 
 inline CLI::App* AddSetCmd(CLI::App* app)
@@ -40,6 +46,17 @@ inline CLI::App* AddSetCountCmd(CLI::App* setCmd, const std::function<void()>& c
     return countCmd;
 }
 
+inline CLI::App* AddSetOrderCmd(CLI::App* setCmd, const std::function<void()>& callback, std::string& colorOrder)
+{
+    auto* orderCmd = setCmd->add_subcommand("order", "Configure the byte order the LED strip expects");
+    orderCmd->add_option("order", colorOrder, "Color order (rgb, rbg, grb, gbr, brg, bgr)")
+        ->required()
+        ->check(CLI::IsMember({"rgb", "rbg", "grb", "gbr", "brg", "bgr"}));
+    orderCmd->callback(callback);
+
+    return orderCmd;
+}
+
 inline CLI::App* AddStartCmd(CLI::App* app, const std::function<void()>& callback)
 {
     auto* startCmd = app->add_subcommand("start", "Start the LED driver control loop");
@@ -56,6 +73,14 @@ inline CLI::App* AddStopCmd(CLI::App* app, const std::function<void()>& callback
     return stopCmd;
 }
 
+inline CLI::App* AddStatusCmd(CLI::App* app, const std::function<void()>& callback)
+{
+    auto* statusCmd = app->add_subcommand("status", "Show the driver state and output thread scheduling");
+    statusCmd->callback(callback);
+
+    return statusCmd;
+}
+
 inline CLI::App* AddFillCmd(CLI::App* app, const std::function<void()>& callback, ColorRGB& color)
 {
     const auto fillCmd = app->add_subcommand("fill", "Fill all LEDs with a solid color");
@@ -68,4 +93,65 @@ inline CLI::App* AddFillCmd(CLI::App* app, const std::function<void()>& callback
     return fillCmd;
 }
 
-} // namespace openskydimo::commands
\ No newline at end of file
+inline CLI::App* AddFrameCmd(CLI::App* app, const std::function<void()>& callback, std::string& format,
+                            std::string& pixels)
+{
+    auto* frameCmd = app->add_subcommand("frame", "Show one frame of pixels, converted to the strip's color order");
+    frameCmd->add_option("format", format, "Pixel layout (rgb, bgr, rgba, bgra, rgb565)")
+        ->required()
+        ->check(CLI::IsMember({"rgb", "bgr", "rgba", "bgra", "rgb565"}));
+    frameCmd->add_option("pixels", pixels, "Pixel bytes as hex, first LED first; LEDs past the end keep their color")
+        ->required();
+    frameCmd->callback(callback);
+
+    return frameCmd;
+}
+
+inline CLI::App* AddRecordCmd(CLI::App* app)
+{
+    return app->add_subcommand("record", "Record transmitted frames to a capture file")->require_subcommand(1);
+}
+
+inline CLI::App* AddRecordStartCmd(CLI::App* recordCmd, const std::function<void()>& callback, std::string& path)
+{
+    auto* startCmd = recordCmd->add_subcommand("start", "Start recording every transmitted frame");
+    startCmd->add_option("file", path, "Capture file to write (overwritten if it exists)")->required();
+    startCmd->callback(callback);
+
+    return startCmd;
+}
+
+inline CLI::App* AddRecordStopCmd(CLI::App* recordCmd, const std::function<void()>& callback)
+{
+    auto* stopCmd = recordCmd->add_subcommand("stop", "Stop recording and finalise the capture file");
+    stopCmd->callback(callback);
+
+    return stopCmd;
+}
+
+inline CLI::App* AddReplayCmd(CLI::App* app)
+{
+    return app->add_subcommand("replay", "Replay a capture file through the LED driver")->require_subcommand(1);
+}
+
+inline CLI::App* AddReplayStartCmd(CLI::App* replayCmd, const std::function<void()>& callback, std::string& path,
+                                   double& rate)
+{
+    auto* startCmd = replayCmd->add_subcommand("start", "Start replaying a capture at its original timing");
+    startCmd->add_option("file", path, "Capture file to replay")->required();
+    startCmd->add_option("--rate", rate, "Playback speed multiplier (e.g. 2 for double speed)")
+        ->check(CLI::PositiveNumber);
+    startCmd->callback(callback);
+
+    return startCmd;
+}
+
+inline CLI::App* AddReplayStopCmd(CLI::App* replayCmd, const std::function<void()>& callback)
+{
+    auto* stopCmd = replayCmd->add_subcommand("stop", "Stop an in-progress replay");
+    stopCmd->callback(callback);
+
+    return stopCmd;
+}
+
+} // namespace openskydimo::commands
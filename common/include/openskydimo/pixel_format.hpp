@@ -0,0 +1,352 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#include <immintrin.h>
+#define OPENSKYDIMO_PIXELS_SSSE3 1
+#endif
+
+#include "openskydimo/types.h"
+
+namespace openskydimo::pixels
+{
+
+// Layout of pixels handed to us by producers
+enum class PixelFormat
+{
+    RGB,
+    BGR,
+    RGBA,
+    BGRA,
+    RGB565, // 16-bit little-endian, red in the high bits
+};
+
+// Byte order the LED strip expects on the wire, which depends on how it is wired
+enum class ColorOrder
+{
+    RGB,
+    RBG,
+    GRB,
+    GBR,
+    BRG,
+    BGR,
+};
+
+inline constexpr std::array<std::string_view, 5> s_pixelFormatNames = {"rgb", "bgr", "rgba", "bgra", "rgb565"};
+
+inline constexpr std::string_view ToString(const PixelFormat format)
+{
+    return s_pixelFormatNames[static_cast<size_t>(format)];
+}
+
+inline constexpr std::optional<PixelFormat> ParsePixelFormat(const std::string_view name)
+{
+    for (size_t i = 0; i < s_pixelFormatNames.size(); ++i)
+    {
+        if (s_pixelFormatNames[i] == name)
+            return static_cast<PixelFormat>(i);
+    }
+
+    return std::nullopt;
+}
+
+inline constexpr std::array<std::string_view, 6> s_colorOrderNames = {"rgb", "rbg", "grb", "gbr", "brg", "bgr"};
+
+inline constexpr std::string_view ToString(const ColorOrder order)
+{
+    return s_colorOrderNames[static_cast<size_t>(order)];
+}
+
+inline constexpr std::optional<ColorOrder> ParseColorOrder(const std::string_view name)
+{
+    for (size_t i = 0; i < s_colorOrderNames.size(); ++i)
+    {
+        if (s_colorOrderNames[i] == name)
+            return static_cast<ColorOrder>(i);
+    }
+
+    return std::nullopt;
+}
+
+template <PixelFormat Format>
+struct PixelFormatTraits;
+
+// channelOffsets holds the byte offset of red, green and blue within one source pixel
+template <>
+struct PixelFormatTraits<PixelFormat::RGB>
+{
+    static constexpr size_t bytesPerPixel = 3;
+    static constexpr std::array<uint8_t, 3> channelOffsets = {0, 1, 2};
+};
+
+template <>
+struct PixelFormatTraits<PixelFormat::BGR>
+{
+    static constexpr size_t bytesPerPixel = 3;
+    static constexpr std::array<uint8_t, 3> channelOffsets = {2, 1, 0};
+};
+
+template <>
+struct PixelFormatTraits<PixelFormat::RGBA>
+{
+    static constexpr size_t bytesPerPixel = 4;
+    static constexpr std::array<uint8_t, 3> channelOffsets = {0, 1, 2};
+};
+
+template <>
+struct PixelFormatTraits<PixelFormat::BGRA>
+{
+    static constexpr size_t bytesPerPixel = 4;
+    static constexpr std::array<uint8_t, 3> channelOffsets = {2, 1, 0};
+};
+
+template <>
+struct PixelFormatTraits<PixelFormat::RGB565>
+{
+    static constexpr size_t bytesPerPixel = 2;
+};
+
+// For each of the three wire bytes, which channel goes there (0 = red, 1 = green, 2 = blue)
+template <ColorOrder Order>
+inline constexpr std::array<uint8_t, 3> s_wireChannels = [] {
+    switch (Order)
+    {
+    case ColorOrder::RBG:
+        return std::array<uint8_t, 3>{0, 2, 1};
+    case ColorOrder::GRB:
+        return std::array<uint8_t, 3>{1, 0, 2};
+    case ColorOrder::GBR:
+        return std::array<uint8_t, 3>{1, 2, 0};
+    case ColorOrder::BRG:
+        return std::array<uint8_t, 3>{2, 0, 1};
+    case ColorOrder::BGR:
+        return std::array<uint8_t, 3>{2, 1, 0};
+    default:
+        return std::array<uint8_t, 3>{0, 1, 2};
+    }
+}();
+
+inline constexpr std::array<uint8_t, 3> WireChannels(const ColorOrder order)
+{
+    switch (order)
+    {
+    case ColorOrder::RBG:
+        return s_wireChannels<ColorOrder::RBG>;
+    case ColorOrder::GRB:
+        return s_wireChannels<ColorOrder::GRB>;
+    case ColorOrder::GBR:
+        return s_wireChannels<ColorOrder::GBR>;
+    case ColorOrder::BRG:
+        return s_wireChannels<ColorOrder::BRG>;
+    case ColorOrder::BGR:
+        return s_wireChannels<ColorOrder::BGR>;
+    default:
+        return s_wireChannels<ColorOrder::RGB>;
+    }
+}
+
+namespace detail
+{
+
+template <PixelFormat Format, ColorOrder Order>
+inline void ConvertPixel(const std::byte* src, std::byte* dst)
+{
+    constexpr auto wire = s_wireChannels<Order>;
+
+    if constexpr (Format == PixelFormat::RGB565)
+    {
+        const auto value = static_cast<uint16_t>(static_cast<uint16_t>(src[0]) | (static_cast<uint16_t>(src[1]) << 8));
+        const auto r = static_cast<uint8_t>((value >> 11) & 0x1f);
+        const auto g = static_cast<uint8_t>((value >> 5) & 0x3f);
+        const auto b = static_cast<uint8_t>(value & 0x1f);
+
+        // Replicate the top bits into the bottom so full scale maps to 255
+        const std::array<std::byte, 3> rgb = {static_cast<std::byte>((r << 3) | (r >> 2)),
+                                              static_cast<std::byte>((g << 2) | (g >> 4)),
+                                              static_cast<std::byte>((b << 3) | (b >> 2))};
+
+        dst[0] = rgb[wire[0]];
+        dst[1] = rgb[wire[1]];
+        dst[2] = rgb[wire[2]];
+    }
+    else
+    {
+        constexpr auto offsets = PixelFormatTraits<Format>::channelOffsets;
+
+        dst[0] = src[offsets[wire[0]]];
+        dst[1] = src[offsets[wire[1]]];
+        dst[2] = src[offsets[wire[2]]];
+    }
+}
+
+#ifdef OPENSKYDIMO_PIXELS_SSSE3
+
+inline bool HasSsse3()
+{
+    static const bool hasSsse3 = __builtin_cpu_supports("ssse3");
+    return hasSsse3;
+}
+
+// pshufb control that turns one 16-byte load into as many packed wire triplets as it holds whole
+// pixels: four pixels for 4-byte formats, five for 3-byte ones. Unused output lanes are zeroed.
+template <PixelFormat Format, ColorOrder Order>
+inline constexpr std::array<int8_t, 16> s_shuffleMask = [] {
+    constexpr size_t bytesPerPixel = PixelFormatTraits<Format>::bytesPerPixel;
+    constexpr auto offsets = PixelFormatTraits<Format>::channelOffsets;
+    constexpr auto wire = s_wireChannels<Order>;
+    constexpr size_t pixelsPerBlock = 16 / bytesPerPixel;
+
+    std::array<int8_t, 16> mask{};
+    mask.fill(static_cast<int8_t>(0x80));
+
+    for (size_t out = 0; out < pixelsPerBlock * 3; ++out)
+        mask[out] = static_cast<int8_t>((out / 3) * bytesPerPixel + offsets[wire[out % 3]]);
+
+    return mask;
+}();
+
+// Returns how many pixels were converted; the caller finishes the tail with the scalar path
+template <PixelFormat Format, ColorOrder Order>
+__attribute__((target("ssse3"))) size_t ConvertSsse3(const std::byte* src, std::byte* dst, const size_t count)
+{
+    constexpr size_t bytesPerPixel = PixelFormatTraits<Format>::bytesPerPixel;
+    constexpr size_t pixelsPerBlock = 16 / bytesPerPixel;
+
+    // Every block loads and stores a full 16 bytes, so stop while both stay inside the buffers
+    constexpr size_t pixelsInBounds = std::max<size_t>((16 + bytesPerPixel - 1) / bytesPerPixel, (16 + 2) / 3);
+
+    const __m128i shuffle = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s_shuffleMask<Format, Order>.data()));
+    size_t i = 0;
+
+    for (; i + pixelsInBounds <= count; i += pixelsPerBlock)
+    {
+        const __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * bytesPerPixel));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 3), _mm_shuffle_epi8(pixels, shuffle));
+    }
+
+    return i;
+}
+
+#endif
+
+} // namespace detail
+
+// Packs count pixels from src into dst as Adalight wire triplets in the given color order, in a
+// single pass. dst must hold count * 3 bytes.
+template <PixelFormat Format, ColorOrder Order>
+void ConvertPixels(const std::byte* src, std::byte* dst, const size_t count)
+{
+    constexpr size_t bytesPerPixel = PixelFormatTraits<Format>::bytesPerPixel;
+    size_t i = 0;
+
+#ifdef OPENSKYDIMO_PIXELS_SSSE3
+    if constexpr (Format != PixelFormat::RGB565)
+    {
+        if (detail::HasSsse3())
+            i = detail::ConvertSsse3<Format, Order>(src, dst, count);
+    }
+#endif
+
+    for (; i < count; ++i)
+        detail::ConvertPixel<Format, Order>(src + i * bytesPerPixel, dst + i * 3);
+}
+
+namespace detail
+{
+
+template <PixelFormat Format>
+void ConvertPixels(const ColorOrder order, const std::byte* src, std::byte* dst, const size_t count)
+{
+    switch (order)
+    {
+    case ColorOrder::RGB:
+        return pixels::ConvertPixels<Format, ColorOrder::RGB>(src, dst, count);
+    case ColorOrder::RBG:
+        return pixels::ConvertPixels<Format, ColorOrder::RBG>(src, dst, count);
+    case ColorOrder::GRB:
+        return pixels::ConvertPixels<Format, ColorOrder::GRB>(src, dst, count);
+    case ColorOrder::GBR:
+        return pixels::ConvertPixels<Format, ColorOrder::GBR>(src, dst, count);
+    case ColorOrder::BRG:
+        return pixels::ConvertPixels<Format, ColorOrder::BRG>(src, dst, count);
+    case ColorOrder::BGR:
+        return pixels::ConvertPixels<Format, ColorOrder::BGR>(src, dst, count);
+    }
+}
+
+} // namespace detail
+
+// Runtime entry point: picks the specialised kernel once per call, not per pixel
+inline void ConvertPixels(const PixelFormat format, const ColorOrder order, const std::byte* src, std::byte* dst,
+                          const size_t count)
+{
+    switch (format)
+    {
+    case PixelFormat::RGB:
+        return detail::ConvertPixels<PixelFormat::RGB>(order, src, dst, count);
+    case PixelFormat::BGR:
+        return detail::ConvertPixels<PixelFormat::BGR>(order, src, dst, count);
+    case PixelFormat::RGBA:
+        return detail::ConvertPixels<PixelFormat::RGBA>(order, src, dst, count);
+    case PixelFormat::BGRA:
+        return detail::ConvertPixels<PixelFormat::BGRA>(order, src, dst, count);
+    case PixelFormat::RGB565:
+        return detail::ConvertPixels<PixelFormat::RGB565>(order, src, dst, count);
+    }
+}
+
+inline constexpr size_t BytesPerPixel(const PixelFormat format)
+{
+    switch (format)
+    {
+    case PixelFormat::RGB:
+    case PixelFormat::BGR:
+        return 3;
+    case PixelFormat::RGBA:
+    case PixelFormat::BGRA:
+        return 4;
+    case PixelFormat::RGB565:
+        return 2;
+    }
+
+    return 0;
+}
+
+// The wire triplet for a single color, e.g. for filling the whole strip
+inline std::array<std::byte, 3> ToWireOrder(const ColorOrder order, const ColorRGB color)
+{
+    const std::array<std::byte, 3> rgb = {color.r, color.g, color.b};
+    std::array<std::byte, 3> wire{};
+    ConvertPixels(PixelFormat::RGB, order, rgb.data(), wire.data(), 1);
+    return wire;
+}
+
+// Re-packs count wire triplets in place from one color order to another, so whatever the strip
+// shows survives a change of order
+inline void ReorderWire(const ColorOrder from, const ColorOrder to, std::byte* data, const size_t count)
+{
+    if (from == to)
+        return;
+
+    const auto fromChannels = WireChannels(from);
+    const auto toChannels = WireChannels(to);
+
+    for (size_t i = 0; i < count; ++i, data += 3)
+    {
+        std::array<std::byte, 3> rgb{};
+
+        for (size_t position = 0; position < 3; ++position)
+            rgb[fromChannels[position]] = data[position];
+
+        for (size_t position = 0; position < 3; ++position)
+            data[position] = rgb[toChannels[position]];
+    }
+}
+
+} // namespace openskydimo::pixels
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+namespace openskydimo::stats
+{
+
+// Nearest-rank percentile of an already sorted sample, e.g. fraction 0.99 for p99. Returns 0 for
+// an empty sample.
+inline double Percentile(const std::vector<double>& sorted, const double fraction)
+{
+    if (sorted.empty())
+        return 0.0;
+
+    const auto rank = static_cast<size_t>(std::ceil(fraction * static_cast<double>(sorted.size())));
+    return sorted[std::clamp<size_t>(rank, 1, sorted.size()) - 1];
+}
+
+} // namespace openskydimo::stats
@@ -22,6 +22,8 @@ struct ColorRGB
           b(static_cast<std::byte>(std::clamp(b, 0, 255)))
     {
     }
+
+    bool operator==(const ColorRGB&) const = default;
 };
 
 template <>
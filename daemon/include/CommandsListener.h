@@ -1,12 +1,14 @@
 #pragma once
 
 #include <atomic>
+#include <functional>
 #include <thread>
 #include <vector>
 
 #include "spdlog/sinks/stdout_color_sinks.h"
 #include "spdlog/spdlog.h"
 
+#include "FrameReplayer.h"
 #include "SkydimoDriver.h"
 #include "openskydimo/commands.hpp"
 
@@ -20,12 +22,33 @@ public:
     void Stop();
     [[nodiscard]] bool ShouldStop() const;
 
+    // Invoked on the listener thread after every successfully executed command
+    void SetCommandExecutedCallback(std::function<void()> callback);
+    // Supplies extra fields for the "status" command, e.g. output thread scheduling
+    void SetStatusCallback(std::function<std::string()> callback);
+
 private:
+    // One connection may carry any number of newline-terminated commands
+    struct Client
+    {
+        int fd = -1;
+        std::string input;
+        std::string output;
+        bool isReadClosed = false;
+        bool isOpen = true;
+    };
+
     void ListenLoop();
 
-    void HandleClient(int clientFd);
+    void AcceptClients();
+    bool ReadFromClient(Client& client);
+    bool RunCommands(Client& client);
+    bool FlushClient(Client& client);
+    [[nodiscard]] bool HasRunnableCommand(const Client& client) const;
 
     [[nodiscard]] std::string ExecuteCommand(const std::string& command);
+    [[nodiscard]] static std::string FormatError(std::string message);
+    [[nodiscard]] std::string BuildStatus() const;
 
 private:
     std::shared_ptr<spdlog::logger> m_logger =
@@ -35,10 +58,31 @@ private:
 
     std::string m_socketPath;
     SkydimoDriver& m_driver;
+    FrameReplayer m_replayer;
+
+    static constexpr size_t m_maxCommandLength = 4096;
+
+    // Per-client limits that keep one pipelining client from starving the rest. A client is not
+    // read from while m_maxBufferedInput bytes are waiting, runs at most m_maxCommandsPerRound
+    // commands per poll() round, and runs none while m_maxBufferedOutput bytes of responses are
+    // unsent. Whatever is left over carries on in the next round.
+    static constexpr size_t m_maxBufferedInput = 64 * 1024;
+    static constexpr size_t m_maxBufferedOutput = 64 * 1024;
+    static constexpr size_t m_maxCommandsPerRound = 64;
 
     int m_serverFd;
+    int m_wakeFd;
     std::atomic<bool> m_isServerRunning;
     std::thread m_listenerThread;
+    std::vector<Client> m_clients;
 
     openskydimo::commands::Args m_cmdArgs;
+    std::function<void()> m_onCommandExecuted;
+    std::function<std::string()> m_statusCallback;
+
+    // Set by commands that reply with more than a plain "OK"
+    std::string m_response;
+
+    // Decoded "frame" payload, kept so its capacity is reused from one frame to the next
+    std::vector<std::byte> m_frameBytes;
 };
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+
+#include "spdlog/sinks/stdout_color_sinks.h"
+#include "spdlog/spdlog.h"
+
+#include "SkydimoDriver.h"
+
+// Persists DriverSettings as a small "key = value" file and watches it for external edits.
+class ConfigStore
+{
+public:
+    explicit ConfigStore(std::string path);
+    ~ConfigStore();
+
+    ConfigStore(const ConfigStore&) = delete;
+    ConfigStore& operator=(const ConfigStore&) = delete;
+
+    // $XDG_CONFIG_HOME/openskydimo/daemon.conf, falling back to ~/.config
+    [[nodiscard]] static std::string DefaultPath();
+
+    [[nodiscard]] const std::string& GetPath() const;
+
+    [[nodiscard]] std::optional<DriverSettings> Load();
+    // Atomically replaces the file; a no-op if the settings match what is already on disk
+    bool Save(const DriverSettings& settings);
+    // Hands the settings to the background writer and returns straight away. Bursts of changes are
+    // coalesced so the file is written at most once per m_saveDelay; anything still queued is
+    // written when the store is destroyed.
+    void RequestSave(const DriverSettings& settings);
+
+    // onChange runs on the watcher thread whenever the file changes to something other than what
+    // this process last loaded or saved
+    bool StartWatching(std::function<void(const DriverSettings&)> onChange);
+    void StopWatching();
+
+private:
+    void WatchLoop();
+    void SaveLoop();
+
+    [[nodiscard]] std::optional<DriverSettings> Parse(const std::string& contents) const;
+    [[nodiscard]] static std::string Serialise(const DriverSettings& settings);
+
+private:
+    std::shared_ptr<spdlog::logger> m_logger =
+        spdlog::get("ConfigStore") ? spdlog::get("ConfigStore") : spdlog::stdout_color_mt("ConfigStore");
+
+    std::string m_path;
+    std::string m_directory;
+    std::string m_fileName;
+
+    // Last settings known to match the file, used to ignore inotify events caused by our own writes
+    std::mutex m_mutex;
+    std::optional<DriverSettings> m_lastKnown;
+
+    std::function<void(const DriverSettings&)> m_onChange;
+    int m_inotifyFd = -1;
+    int m_wakeFd = -1;
+    std::atomic<bool> m_isWatching = false;
+    std::thread m_watchThread;
+
+    static constexpr std::chrono::seconds m_saveDelay{1};
+
+    std::mutex m_saveMutex;
+    std::condition_variable m_saveCondition;
+    std::optional<DriverSettings> m_pendingSave;
+    bool m_isClosing = false;
+    std::thread m_saveThread;
+};
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+
+#include "spdlog/sinks/stdout_color_sinks.h"
+#include "spdlog/spdlog.h"
+
+// Sleeps until something changes near a device path (via inotify), an open device hangs up, a
+// timeout expires, or another thread calls Interrupt(). Used to notice a serial adapter being
+// unplugged and plugged back in.
+class DeviceWatcher
+{
+public:
+    enum class WaitResult
+    {
+        Changed,
+        TimedOut,
+        Interrupted,
+        HungUp,
+    };
+
+    DeviceWatcher();
+    ~DeviceWatcher();
+
+    DeviceWatcher(const DeviceWatcher&) = delete;
+    DeviceWatcher& operator=(const DeviceWatcher&) = delete;
+
+    // Watches the nearest existing directory containing devicePath. Directories such as
+    // /dev/serial/by-id disappear with the last device, so this is re-evaluated on every call.
+    bool Watch(const std::string& devicePath);
+    void Unwatch();
+
+    // A negative timeout waits indefinitely. If hangupFd is given, also returns once it reports
+    // POLLHUP or POLLERR, so an idle device going away is noticed without a failed write.
+    WaitResult Wait(std::chrono::milliseconds timeout, int hangupFd = -1);
+    // Safe to call from any thread, including while holding locks
+    void Interrupt();
+
+private:
+    std::shared_ptr<spdlog::logger> m_logger =
+        spdlog::get("DeviceWatcher") ? spdlog::get("DeviceWatcher") : spdlog::stdout_color_mt("DeviceWatcher");
+
+    int m_inotifyFd = -1;
+    int m_wakeFd = -1;
+    int m_watchDescriptor = -1;
+    std::string m_watchedDirectory;
+};
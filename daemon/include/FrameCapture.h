@@ -0,0 +1,48 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+// On-disk layout of a frame capture (all integers little-endian, native packing):
+//
+//   CaptureHeader
+//   FrameRecordHeader + payload   (repeated, one per transmitted frame)
+//   CaptureIndexEntry[frameCount] (written when the recording is stopped)
+//
+// The header is rewritten on stop with the final frame count and index offset. A capture that
+// was never finalised (daemon crashed) has indexOffset == 0 and can still be replayed by walking
+// the records sequentially.
+namespace openskydimo::capture
+{
+
+inline constexpr std::array<char, 8> s_magic = {'O', 'S', 'K', 'Y', 'C', 'A', 'P', '\0'};
+inline constexpr uint32_t s_version = 1;
+
+struct CaptureHeader
+{
+    std::array<char, 8> magic = s_magic;
+    uint32_t version = s_version;
+    uint32_t reserved = 0;
+    int64_t startTimeUnixNs = 0; // Wall-clock time the recording started, informational only
+    uint64_t frameCount = 0;
+    uint64_t indexOffset = 0;
+};
+
+struct FrameRecordHeader
+{
+    int64_t timestampNs = 0; // Monotonic time since the start of the recording
+    uint32_t payloadSize = 0;
+    uint32_t reserved = 0;
+};
+
+struct CaptureIndexEntry
+{
+    int64_t timestampNs = 0;
+    uint64_t recordOffset = 0; // File offset of the FrameRecordHeader
+};
+
+static_assert(sizeof(CaptureHeader) == 40);
+static_assert(sizeof(FrameRecordHeader) == 16);
+static_assert(sizeof(CaptureIndexEntry) == 16);
+
+} // namespace openskydimo::capture
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <span>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "spdlog/sinks/stdout_color_sinks.h"
+#include "spdlog/spdlog.h"
+
+#include "FrameCapture.h"
+
+// Appends every transmitted frame to a capture file. Push() is called from the output path and
+// only copies into a preallocated slot; the file I/O happens on a background thread.
+class FrameRecorder
+{
+public:
+    FrameRecorder() = default;
+    ~FrameRecorder();
+
+    FrameRecorder(const FrameRecorder&) = delete;
+    FrameRecorder& operator=(const FrameRecorder&) = delete;
+
+    bool Start(const std::string& path);
+    void Stop();
+    [[nodiscard]] bool IsRecording() const;
+
+    // Never blocks. Frames are dropped (and counted) if the writer thread falls behind.
+    void Push(std::span<const std::byte> payload);
+
+private:
+    void WriterLoop();
+    bool WriteSlot(size_t slotIndex);
+    bool Flush();
+    bool WriteIndex();
+    void Finalise();
+
+private:
+    std::shared_ptr<spdlog::logger> m_logger =
+        spdlog::get("FrameRecorder") ? spdlog::get("FrameRecorder") : spdlog::stdout_color_mt("FrameRecorder");
+
+    static constexpr size_t m_slotCount = 256;
+    static constexpr size_t m_maxPayloadSize = 255 * 3; // Adalight header caps the strip at 255 LEDs
+    static constexpr size_t m_flushThreshold = 64 * 1024;
+
+    static constexpr size_t m_indexBatchSize = m_flushThreshold / sizeof(openskydimo::capture::CaptureIndexEntry);
+
+    struct Slot
+    {
+        int64_t timestampNs = 0;
+        uint32_t payloadSize = 0;
+        std::array<std::byte, m_maxPayloadSize> payload{};
+    };
+
+    // Single-producer/single-consumer ring: Push() advances m_writeIndex, the writer thread
+    // advances m_readIndex. Both only ever increase; the slot is index % m_slotCount.
+    std::vector<Slot> m_slots = std::vector<Slot>(m_slotCount);
+    std::atomic<uint64_t> m_writeIndex = 0;
+    std::atomic<uint64_t> m_readIndex = 0;
+    std::atomic<uint32_t> m_wakeups = 0;
+
+    std::atomic<bool> m_isRecording = false;
+    std::atomic<uint64_t> m_droppedFrames = 0;
+    std::chrono::steady_clock::time_point m_startTime;
+
+    std::string m_path;
+    int m_fd = -1;
+    uint64_t m_fileOffset = 0;
+    std::vector<std::byte> m_pending;
+    std::vector<openskydimo::capture::CaptureIndexEntry> m_pendingIndex;
+    openskydimo::capture::CaptureHeader m_header;
+
+    std::thread m_writerThread;
+};
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <span>
+#include <string>
+#include <thread>
+
+#include "spdlog/sinks/stdout_color_sinks.h"
+#include "spdlog/spdlog.h"
+
+// Plays a capture written by FrameRecorder back into a frame sink, normally the driver. The file is
+// memory-mapped, so captures of any length are streamed from the page cache rather than loaded into RAM.
+class FrameReplayer
+{
+public:
+    // Called on the replay thread with each frame's wire-ordered triplets, at the frame's deadline
+    using FrameSink = std::function<void(std::span<const std::byte>)>;
+
+    explicit FrameReplayer(FrameSink sink);
+    ~FrameReplayer();
+
+    FrameReplayer(const FrameReplayer&) = delete;
+    FrameReplayer& operator=(const FrameReplayer&) = delete;
+
+    // rate scales playback speed: 2.0 plays twice as fast, 0.5 at half speed
+    bool Start(const std::string& path, double rate);
+    void Stop();
+    [[nodiscard]] bool IsReplaying() const;
+
+private:
+    void ReplayLoop();
+    void Unmap();
+
+private:
+    std::shared_ptr<spdlog::logger> m_logger =
+        spdlog::get("FrameReplayer") ? spdlog::get("FrameReplayer") : spdlog::stdout_color_mt("FrameReplayer");
+
+    FrameSink m_sink;
+
+    std::string m_path;
+    double m_rate = 1.0;
+
+    const std::byte* m_data = nullptr;
+    size_t m_size = 0;
+
+    std::atomic<bool> m_isReplaying = false;
+    std::thread m_replayThread;
+};
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <semaphore>
+#include <string>
+#include <thread>
+
+#include "spdlog/sinks/stdout_color_sinks.h"
+#include "spdlog/spdlog.h"
+
+#include "SkydimoDriver.h"
+
+struct OutputThreadOptions
+{
+    std::string policy = "other"; // "other", "fifo" or "rr"
+    int priority = 0;             // Only meaningful for fifo/rr
+    int cpu = -1;                 // Pin to this CPU, or -1 to let the scheduler decide
+    bool lockMemory = false;      // mlockall() so the output path never page-faults
+    std::chrono::milliseconds interval{100};
+};
+
+// Sends the driver's current frame at a fixed interval on a dedicated thread, optionally with a
+// real-time scheduling policy. Anything that cannot be applied (usually for lack of privileges)
+// is logged and skipped; GetSchedulingReport() describes what was actually obtained.
+class OutputThread
+{
+public:
+    OutputThread(SkydimoDriver& driver, OutputThreadOptions options);
+    ~OutputThread();
+
+    OutputThread(const OutputThread&) = delete;
+    OutputThread& operator=(const OutputThread&) = delete;
+
+    void Start();
+    void Stop();
+
+    [[nodiscard]] const std::string& GetSchedulingReport() const;
+
+private:
+    void OutputLoop();
+    // Runs on the output thread itself, before it sends its first frame
+    void ApplyScheduling();
+
+private:
+    std::shared_ptr<spdlog::logger> m_logger =
+        spdlog::get("OutputThread") ? spdlog::get("OutputThread") : spdlog::stdout_color_mt("OutputThread");
+
+    SkydimoDriver& m_driver;
+    OutputThreadOptions m_options;
+    std::string m_schedulingReport;
+
+    std::atomic<bool> m_isRunning = false;
+    std::binary_semaphore m_isScheduled{0}; // Released once ApplyScheduling() has filled in the report
+    std::thread m_thread;
+};
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <pthread.h>
+
+// A mutex whose holder is boosted to the priority of the highest-priority thread waiting on it, so
+// a real-time thread can't be stuck behind a normal one that got preempted while holding the lock.
+// The lowercase members make it a standard Lockable for std::lock_guard and std::unique_lock.
+class PriorityInheritanceMutex
+{
+public:
+    PriorityInheritanceMutex()
+    {
+        pthread_mutexattr_t attributes;
+        pthread_mutexattr_init(&attributes);
+        pthread_mutexattr_setprotocol(&attributes, PTHREAD_PRIO_INHERIT);
+        pthread_mutex_init(&m_mutex, &attributes);
+        pthread_mutexattr_destroy(&attributes);
+    }
+
+    ~PriorityInheritanceMutex()
+    {
+        pthread_mutex_destroy(&m_mutex);
+    }
+
+    PriorityInheritanceMutex(const PriorityInheritanceMutex&) = delete;
+    PriorityInheritanceMutex& operator=(const PriorityInheritanceMutex&) = delete;
+
+    void lock()
+    {
+        pthread_mutex_lock(&m_mutex);
+    }
+
+    bool try_lock()
+    {
+        return pthread_mutex_trylock(&m_mutex) == 0;
+    }
+
+    void unlock()
+    {
+        pthread_mutex_unlock(&m_mutex);
+    }
+
+private:
+    pthread_mutex_t m_mutex;
+};
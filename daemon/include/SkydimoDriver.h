@@ -1,49 +1,140 @@
 #pragma once
+#include "openskydimo/pixel_format.hpp"
 #include "openskydimo/types.h"
 
+#include <array>
+#include <atomic>
+#include <chrono>
 #include <mutex>
+#include <optional>
+#include <span>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include "spdlog/sinks/stdout_color_sinks.h"
 #include "spdlog/spdlog.h"
 
+#include "DeviceWatcher.h"
+#include "FrameRecorder.h"
+#include "PriorityInheritanceMutex.h"
+#include "TripleBuffer.h"
+
+// Everything needed to bring the driver back to its current state, e.g. after a restart
+struct DriverSettings
+{
+    std::string serialPort;
+    int ledCount = 0;
+    int baudRate = 115200;
+    std::optional<ColorRGB> fillColor;
+    bool connect = false; // Whether the serial connection should be open
+    openskydimo::pixels::ColorOrder colorOrder = openskydimo::pixels::ColorOrder::RGB;
+
+    bool operator==(const DriverSettings&) const = default;
+};
+
 class SkydimoDriver
 {
 
 public:
-    SkydimoDriver() = default;
+    SkydimoDriver();
     ~SkydimoDriver();
 
     void SetSerialPort(const std::string& portName);
     void SetBaudRate(int baudRate);
     void SetLedCount(int ledCount);
+    void SetColorOrder(openskydimo::pixels::ColorOrder colorOrder);
 
     bool OpenSerialConnection();
     void CloseSerialConnection();
 
+    [[nodiscard]] DriverSettings GetSettings() const;
+    void ApplySettings(const DriverSettings& settings);
+
     [[nodiscard]] bool IsReadyToSend() const;
-    void SendColors() const;
+    // Returns true if a complete frame was written to the serial port
+    bool SendColors();
     void Fill(ColorRGB color);
+    // Copies wire-ordered triplets straight into the LED section of the frame, e.g. from a capture
+    void SetColors(std::span<const std::byte> colors);
+    // Converts producer pixels into the device's color order in a single pass over the input
+    void SetPixels(openskydimo::pixels::PixelFormat format, std::span<const std::byte> pixels);
+
+    bool StartRecording(const std::string& path);
+    void StopRecording();
+    [[nodiscard]] bool IsRecording() const;
 
 private:
+    // The setters' bodies, for callers that already hold m_mutex
+    void SetLedCountLocked(int ledCount);
+    void SetColorOrderLocked(openskydimo::pixels::ColorOrder colorOrder);
+    void FillLocked(ColorRGB color);
+    // Validates the settings and marks the connection as wanted; false if it can't be opened
+    bool RequestConnectionLocked();
+    void CloseSerialConnectionLocked();
+
     void AddHeaderToBuffer();
+    void FillBuffer(ColorRGB color);
+    void PublishBuffer();
+
+    // Opens and configures the tty without touching driver state; returns the fd or -1
+    [[nodiscard]] int OpenPort(const std::string& portName, int baudRate,
+                               spdlog::level::level_enum failureLevel) const;
+    bool ConnectPort(const std::string& portName, int baudRate);
+    bool InstallPort(int fd, const std::string& portName);
+    void HandleDisconnect(const char* reason);
+    void ReconnectLoop();
 
 private:
     std::shared_ptr<spdlog::logger> logger =
         spdlog::get("SkydimoDriver") ? spdlog::get("SkydimoDriver") : spdlog::stdout_color_mt("SkydimoDriver");
 
-    // Thread synchronization - mutable to allow locking in const methods
+    // Control state, guarded by m_mutex. Only control threads take it, never the output path, so
+    // a slow command can't delay a frame. Lock order is m_mutex, then m_sendMutex.
     mutable std::mutex m_mutex;
 
-    bool m_isReadyToSend = false;
+    bool m_shouldBeConnected = false; // Set by OpenSerialConnection, cleared by CloseSerialConnection
+    bool m_isShuttingDown = false;
 
     static constexpr int m_headerSize = 6;
-    int m_serialPort = -1;
+    static constexpr int m_maxLedCount = 255; // The Adalight header has a single byte for the count
 
     std::string m_portName;
     int m_ledCount = 0;
     int m_baudRate = 115200;
+    std::optional<ColorRGB> m_fillColor;
+    openskydimo::pixels::ColorOrder m_colorOrder = openskydimo::pixels::ColorOrder::RGB;
+
+    std::vector<std::byte> m_buffer; // The frame being composed by control threads
+
+    // Frames travel from m_buffer to SendColors through this without a lock: PublishBuffer() runs
+    // under m_mutex and SendColors under m_sendMutex, so each end has a single user at a time
+    struct Frame
+    {
+        std::array<std::byte, m_headerSize + m_maxLedCount * 3> data{};
+        size_t size = 0;
+    };
+
+    TripleBuffer<Frame> m_frames;
+
+    // Output state, guarded by m_sendMutex. SendColors takes only this lock, and control threads
+    // hold it just long enough to swap the port, so a real-time sender waits briefly at worst.
+    PriorityInheritanceMutex m_sendMutex;
+
+    std::atomic<bool> m_isReadyToSend = false; // Written under m_sendMutex, readable without it
+    int m_serialPort = -1;
+    std::string m_connectedPortName;
+    uint64_t m_connectionCount = 0; // Bumped by InstallPort so a stale hangup can't close a new port
+    std::chrono::steady_clock::time_point m_connectTime;
+    std::chrono::steady_clock::time_point m_disconnectTime;
+
+    FrameRecorder m_recorder;
+    bool m_isRecording = false;
 
-    std::vector<std::byte> m_buffer;
+    static constexpr std::chrono::milliseconds m_minReconnectBackoff{10};
+    static constexpr std::chrono::milliseconds m_maxReconnectBackoff{2000};
+    // A port that drops sooner than this after opening counts as flapping and doesn't reset the backoff
+    static constexpr std::chrono::milliseconds m_minStableUptime{1000};
+    DeviceWatcher m_deviceWatcher;
+    std::thread m_reconnectThread; // Declared last so everything it uses exists before it starts
 };
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+// Hands the latest value from one producer to one consumer without either side ever waiting. The
+// producer fills Back() and publishes it; the consumer calls Update() and reads Front(), which is
+// always a complete value that the producer won't touch until the consumer moves on.
+template <typename T>
+class TripleBuffer
+{
+public:
+    // Producer side. Back() holds stale contents after a Publish(), so fill it completely.
+    T& Back()
+    {
+        return m_slots[m_back];
+    }
+
+    void Publish()
+    {
+        m_back = m_middle.exchange(m_back | m_freshFlag, std::memory_order_acq_rel) & m_indexMask;
+    }
+
+    // Consumer side. Returns true if a newer value was published since the last call.
+    bool Update()
+    {
+        if (!(m_middle.load(std::memory_order_relaxed) & m_freshFlag))
+            return false;
+
+        m_front = m_middle.exchange(m_front, std::memory_order_acq_rel) & m_indexMask;
+        return true;
+    }
+
+    const T& Front() const
+    {
+        return m_slots[m_front];
+    }
+
+private:
+    static constexpr uint8_t m_indexMask = 0x3;
+    static constexpr uint8_t m_freshFlag = 0x4;
+
+    std::array<T, 3> m_slots{};
+    uint8_t m_back = 0;
+    std::atomic<uint8_t> m_middle = 1; // Slot index plus m_freshFlag once published
+    uint8_t m_front = 2;
+};
@@ -1,7 +1,12 @@
 #include "CommandsListener.h"
 
+#include <algorithm>
 #include <cerrno>
 #include <cstring>
+#include <filesystem>
+#include <poll.h>
+#include <stdexcept>
+#include <sys/eventfd.h>
 #include <sys/socket.h>
 #include <sys/un.h>
 #include <unistd.h>
@@ -11,8 +16,51 @@
 
 #include "openskydimo/commands.hpp"
 
+namespace
+{
+
+int HexDigit(const char c)
+{
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F')
+        return c - 'A' + 10;
+
+    throw std::invalid_argument(fmt::format("'{}' is not a hex digit", c));
+}
+
+void DecodeHex(const std::string& hex, std::vector<std::byte>& out)
+{
+    if (hex.size() % 2 != 0)
+        throw std::invalid_argument("pixel data must be an even number of hex digits");
+
+    out.resize(hex.size() / 2);
+
+    for (size_t i = 0; i < out.size(); ++i)
+        out[i] = static_cast<std::byte>((HexDigit(hex[2 * i]) << 4) | HexDigit(hex[2 * i + 1]));
+}
+
+// The daemon's working directory has nothing to do with the client's, so a relative path would
+// silently land somewhere else
+const std::string& RequireAbsolutePath(const std::string& path)
+{
+    if (!std::filesystem::path(path).is_absolute())
+        throw std::invalid_argument(fmt::format("'{}' is not an absolute path", path));
+
+    return path;
+}
+
+} // namespace
+
 CommandsListener::CommandsListener(std::string socketPath, SkydimoDriver& driver)
-    : m_socketPath(std::move(socketPath)), m_driver(driver), m_serverFd(-1), m_isServerRunning(false)
+    : m_socketPath(std::move(socketPath)), m_driver(driver),
+      m_replayer([&driver](const std::span<const std::byte> colors) {
+          driver.SetColors(colors);
+          driver.SendColors();
+      }),
+      m_serverFd(-1), m_wakeFd(-1), m_isServerRunning(false)
 {
     using namespace openskydimo::commands;
 
@@ -21,9 +69,43 @@ CommandsListener::CommandsListener(std::string socketPath, SkydimoDriver& driver
     const auto setCmd = AddSetCmd(&m_app);
     AddSetPortCmd(setCmd, [this] { m_driver.SetSerialPort(m_cmdArgs.serialPort); }, m_cmdArgs.serialPort);
     AddSetCountCmd(setCmd, [this] { m_driver.SetLedCount(m_cmdArgs.ledCount); }, m_cmdArgs.ledCount);
+    AddSetOrderCmd(
+        setCmd,
+        [this] {
+            if (const auto order = openskydimo::pixels::ParseColorOrder(m_cmdArgs.colorOrder))
+                m_driver.SetColorOrder(*order);
+        },
+        m_cmdArgs.colorOrder);
 
     AddStartCmd(&m_app, [this] { m_driver.OpenSerialConnection(); });
     AddStopCmd(&m_app, [this] { m_driver.CloseSerialConnection(); });
+    AddStatusCmd(&m_app, [this] { m_response = BuildStatus(); });
+    AddFrameCmd(
+        &m_app,
+        [this] {
+            DecodeHex(m_cmdArgs.pixelData, m_frameBytes);
+
+            if (const auto format = openskydimo::pixels::ParsePixelFormat(m_cmdArgs.pixelFormat))
+                m_driver.SetPixels(*format, m_frameBytes);
+        },
+        m_cmdArgs.pixelFormat, m_cmdArgs.pixelData);
+
+    const auto recordCmd = AddRecordCmd(&m_app);
+    AddRecordStartCmd(
+        recordCmd, [this] { m_driver.StartRecording(RequireAbsolutePath(m_cmdArgs.recordPath)); },
+        m_cmdArgs.recordPath);
+    AddRecordStopCmd(recordCmd, [this] { m_driver.StopRecording(); });
+
+    // --rate is optional, so reset it after each replay rather than letting it leak into the next one
+    const auto replayCmd = AddReplayCmd(&m_app);
+    AddReplayStartCmd(
+        replayCmd,
+        [this] {
+            const double rate = std::exchange(m_cmdArgs.replayRate, 1.0);
+            m_replayer.Start(RequireAbsolutePath(m_cmdArgs.replayPath), rate);
+        },
+        m_cmdArgs.replayPath, m_cmdArgs.replayRate);
+    AddReplayStopCmd(replayCmd, [this] { m_replayer.Stop(); });
 }
 
 CommandsListener::~CommandsListener()
@@ -36,7 +118,7 @@ void CommandsListener::Start()
     if (m_isServerRunning)
         return;
 
-    m_serverFd = socket(AF_UNIX, SOCK_STREAM, 0);
+    m_serverFd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
 
     if (m_serverFd < 0)
     {
@@ -66,6 +148,16 @@ void CommandsListener::Start()
         return;
     }
 
+    m_wakeFd = eventfd(0, EFD_CLOEXEC);
+
+    if (m_wakeFd < 0)
+    {
+        m_logger->error("Error creating eventfd: {}", strerror(errno));
+        close(m_serverFd);
+        unlink(m_socketPath.c_str());
+        return;
+    }
+
     m_logger->info("Socket listening on {}", m_socketPath);
     m_isServerRunning = true;
     m_listenerThread = std::thread(&CommandsListener::ListenLoop, this);
@@ -78,17 +170,28 @@ void CommandsListener::Stop()
 
     m_isServerRunning = false;
 
-    // Close socket to unblock accept()
+    // Wake poll() so the listener thread notices it should exit
+    constexpr uint64_t wake = 1;
+    if (write(m_wakeFd, &wake, sizeof(wake)) < 0)
+        m_logger->warn("Failed to wake listener thread: {}", strerror(errno));
+
+    if (m_listenerThread.joinable())
+    {
+        m_listenerThread.join();
+    }
+
+    for (const Client& client : m_clients)
+        close(client.fd);
+    m_clients.clear();
+
     if (m_serverFd >= 0)
     {
-        shutdown(m_serverFd, SHUT_RDWR);
         close(m_serverFd);
         m_serverFd = -1;
     }
-    if (m_listenerThread.joinable())
-    {
-        m_listenerThread.join();
-    }
+
+    close(m_wakeFd);
+    m_wakeFd = -1;
 
     unlink(m_socketPath.c_str());
 }
@@ -98,65 +201,270 @@ bool CommandsListener::ShouldStop() const
     return !m_isServerRunning;
 }
 
+void CommandsListener::SetCommandExecutedCallback(std::function<void()> callback)
+{
+    m_onCommandExecuted = std::move(callback);
+}
+
+void CommandsListener::SetStatusCallback(std::function<std::string()> callback)
+{
+    m_statusCallback = std::move(callback);
+}
+
 void CommandsListener::ListenLoop()
 {
+    std::vector<pollfd> fds;
+
     while (m_isServerRunning)
     {
-        const int clientFd = accept(m_serverFd, nullptr, nullptr);
+        fds.clear();
+        fds.push_back({m_wakeFd, POLLIN, 0});
+        fds.push_back({m_serverFd, POLLIN, 0});
+
+        bool hasRunnableCommands = false;
+
+        for (const Client& client : m_clients)
+        {
+            short events = 0;
+
+            if (!client.isReadClosed && client.input.size() < m_maxBufferedInput)
+                events |= POLLIN;
+
+            if (!client.output.empty())
+                events |= POLLOUT;
+
+            fds.push_back({client.fd, events, 0});
+            hasRunnableCommands |= HasRunnableCommand(client);
+        }
+
+        // Commands left over from a capped round run next time around without waiting for more input
+        if (poll(fds.data(), fds.size(), hasRunnableCommands ? 0 : -1) < 0)
+        {
+            if (errno == EINTR)
+                continue;
+
+            m_logger->error("Error polling sockets: {}", strerror(errno));
+            break;
+        }
+
+        if (!m_isServerRunning)
+            break;
+
+        // Clients accepted below are polled from the next iteration, so only the existing ones are
+        // matched against fds here
+        for (size_t i = 0; i < m_clients.size(); ++i)
+        {
+            Client& client = m_clients[i];
+            const short revents = fds[i + 2].revents;
+
+            if (revents & (POLLIN | POLLHUP | POLLERR))
+                client.isOpen = ReadFromClient(client);
+
+            if (client.isOpen)
+                client.isOpen = RunCommands(client);
+
+            if (client.isOpen && !client.output.empty())
+                client.isOpen = FlushClient(client);
+
+            // A client that has finished sending is closed once it has all of its responses
+            if (client.isOpen && client.isReadClosed && client.input.empty() && client.output.empty())
+                client.isOpen = false;
+        }
+
+        std::erase_if(m_clients, [](const Client& client) {
+            if (!client.isOpen)
+                close(client.fd);
+            return !client.isOpen;
+        });
+
+        if (fds[1].revents & POLLIN)
+            AcceptClients();
+    }
+}
+
+void CommandsListener::AcceptClients()
+{
+    while (true)
+    {
+        const int clientFd = accept4(m_serverFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
 
         if (clientFd < 0)
         {
-            if (!m_isServerRunning)
-                break;
+            if (errno == EINTR)
+                continue;
+
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+                m_logger->error("Error accepting client connection: {}", strerror(errno));
 
+            return;
+        }
+
+        m_clients.emplace_back().fd = clientFd;
+    }
+}
+
+bool CommandsListener::ReadFromClient(Client& client)
+{
+    char buffer[4096];
+
+    // Stopping at m_maxBufferedInput also bounds how much one client can be read per round
+    while (client.input.size() < m_maxBufferedInput)
+    {
+        const ssize_t bytesRead =
+            read(client.fd, buffer, std::min(sizeof(buffer), m_maxBufferedInput - client.input.size()));
+
+        if (bytesRead < 0)
+        {
             if (errno == EINTR)
                 continue;
 
-            m_logger->error("Error accepting client connection: {}", strerror(errno));
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                break;
+
+            m_logger->warn("Failed to read from client: {}", strerror(errno));
+            return false;
+        }
+
+        if (bytesRead == 0)
+        {
+            client.isReadClosed = true;
             break;
         }
 
-        HandleClient(clientFd);
-        close(clientFd);
+        client.input.append(buffer, static_cast<size_t>(bytesRead));
     }
+
+    return true;
 }
 
-void CommandsListener::HandleClient(const int clientFd)
+bool CommandsListener::RunCommands(Client& client)
 {
-    char buffer[1024];
+    // Every complete line is one command and gets exactly one response line, in order
+    size_t lineStart = 0;
 
-    if (const ssize_t bytesRead = read(clientFd, buffer, sizeof(buffer) - 1); bytesRead > 0)
+    for (size_t executed = 0; executed < m_maxCommandsPerRound && client.output.size() < m_maxBufferedOutput;
+         ++executed)
     {
-        buffer[bytesRead] = '\0';
-        std::string command(buffer);
-        if (!command.empty() && command.back() == '\n')
+        const size_t newline = client.input.find('\n', lineStart);
+
+        if (newline == std::string::npos)
+        {
+            // A final command without a trailing newline still counts once the client stops sending
+            if (client.isReadClosed && lineStart < client.input.size())
+            {
+                client.output += ExecuteCommand(client.input.substr(lineStart));
+                lineStart = client.input.size();
+            }
+
+            break;
+        }
+
+        std::string command = client.input.substr(lineStart, newline - lineStart);
+        if (!command.empty() && command.back() == '\r')
             command.pop_back();
 
-        const auto response = ExecuteCommand(command);
+        client.output += ExecuteCommand(command);
+        lineStart = newline + 1;
+    }
+
+    client.input.erase(0, lineStart);
+
+    if (client.input.size() > m_maxCommandLength && client.input.find('\n') == std::string::npos)
+    {
+        m_logger->warn("Dropping client that sent a line over {} bytes", m_maxCommandLength);
+        return false;
+    }
+
+    return true;
+}
+
+bool CommandsListener::HasRunnableCommand(const Client& client) const
+{
+    if (client.output.size() >= m_maxBufferedOutput)
+        return false;
+
+    return client.input.find('\n') != std::string::npos || (client.isReadClosed && !client.input.empty());
+}
+
+bool CommandsListener::FlushClient(Client& client)
+{
+    while (!client.output.empty())
+    {
+        // MSG_NOSIGNAL: a client that hangs up with replies pending must not SIGPIPE the daemon
+        const ssize_t bytesWritten = send(client.fd, client.output.data(), client.output.size(), MSG_NOSIGNAL);
+
+        if (bytesWritten < 0)
+        {
+            if (errno == EINTR)
+                continue;
+
+            // Socket buffer is full; poll() reports when the client has read some of it
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                return true;
+
+            // The client closed its end; it is dropped like any other disconnect
+            if (errno == EPIPE || errno == ECONNRESET)
+            {
+                m_logger->debug("Client disconnected before reading its responses");
+                return false;
+            }
 
-        if (write(clientFd, response.c_str(), response.size()) < 0)
             m_logger->warn("Failed to write response to client: {}", strerror(errno));
+            return false;
+        }
+
+        client.output.erase(0, static_cast<size_t>(bytesWritten));
     }
+
+    return true;
 }
 
 std::string CommandsListener::ExecuteCommand(const std::string& command)
 {
-    m_logger->info("Executing command {}", command);
+    m_logger->debug("Executing command {}", command);
+
+    m_response.clear();
 
     try
     {
         m_app.parse(command, false);
 
-        return "OK\n";
+        if (m_onCommandExecuted)
+            m_onCommandExecuted();
+
+        return m_response.empty() ? "OK\n" : m_response;
     }
     catch (const CLI::ParseError& e)
     {
         m_logger->error("Error executing command: {}", e.what());
-        return "ERROR: " + std::string(e.what()) + "\n";
+        return FormatError(e.what());
     }
     catch (const std::exception& e)
     {
         m_logger->error("Error executing command: {}", e.what());
-        return "ERROR: " + std::string(e.what()) + "\n";
+        return FormatError(e.what());
     }
 }
+
+std::string CommandsListener::FormatError(std::string message)
+{
+    // Responses are framed by newlines, so a multi-line message must not leak extra lines
+    std::ranges::replace(message, '\n', ' ');
+    return "ERROR: " + message + "\n";
+}
+
+std::string CommandsListener::BuildStatus() const
+{
+    const DriverSettings settings = m_driver.GetSettings();
+
+    // Single line so that clients reading up to the first newline get the whole reply
+    std::string status =
+        fmt::format("OK port={} count={} baud={} order={} connected={} recording={} replaying={}", settings.serialPort,
+                    settings.ledCount, settings.baudRate, openskydimo::pixels::ToString(settings.colorOrder),
+                    m_driver.IsReadyToSend(), m_driver.IsRecording(), m_replayer.IsReplaying());
+
+    if (m_statusCallback)
+        status += " " + m_statusCallback();
+
+    return status + "\n";
+}
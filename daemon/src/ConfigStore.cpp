@@ -0,0 +1,474 @@
+#include "ConfigStore.h"
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <charconv>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <fstream>
+#include <poll.h>
+#include <set>
+#include <sstream>
+#include <string_view>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <utility>
+
+namespace
+{
+
+// Serialise always writes these, so a file without one of them was cut short
+constexpr std::array<std::string_view, 5> s_requiredKeys = {"port", "count", "baud", "order", "connect"};
+
+std::string Trim(const std::string& value)
+{
+    const auto first = value.find_first_not_of(" \t\r");
+
+    if (first == std::string::npos)
+        return {};
+
+    const auto last = value.find_last_not_of(" \t\r");
+    return value.substr(first, last - first + 1);
+}
+
+// Unlike std::stoi, rejects trailing characters, so "60" cut down to "6x" or "6 0" is not read as 6
+int ParseInt(const std::string& value)
+{
+    int result = 0;
+    const auto [end, error] = std::from_chars(value.data(), value.data() + value.size(), result);
+
+    if (error != std::errc() || end != value.data() + value.size())
+        throw std::invalid_argument("expected a whole number");
+
+    return result;
+}
+
+bool WriteAll(const int fd, const std::string& data)
+{
+    size_t totalWritten = 0;
+
+    while (totalWritten < data.size())
+    {
+        const ssize_t written = write(fd, data.data() + totalWritten, data.size() - totalWritten);
+
+        if (written < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+
+        totalWritten += static_cast<size_t>(written);
+    }
+
+    return true;
+}
+
+} // namespace
+
+ConfigStore::ConfigStore(std::string path) : m_path(std::move(path))
+{
+    const std::filesystem::path fsPath(m_path);
+    m_directory = fsPath.has_parent_path() ? fsPath.parent_path().string() : ".";
+    m_fileName = fsPath.filename().string();
+
+    m_saveThread = std::thread(&ConfigStore::SaveLoop, this);
+}
+
+ConfigStore::~ConfigStore()
+{
+    StopWatching();
+
+    {
+        std::lock_guard lock(m_saveMutex);
+        m_isClosing = true;
+    }
+
+    m_saveCondition.notify_one();
+    m_saveThread.join();
+}
+
+std::string ConfigStore::DefaultPath()
+{
+    if (const char* configHome = std::getenv("XDG_CONFIG_HOME"); configHome != nullptr && *configHome != '\0')
+        return std::string(configHome) + "/openskydimo/daemon.conf";
+
+    if (const char* home = std::getenv("HOME"); home != nullptr && *home != '\0')
+        return std::string(home) + "/.config/openskydimo/daemon.conf";
+
+    return "/etc/openskydimo/daemon.conf";
+}
+
+const std::string& ConfigStore::GetPath() const
+{
+    return m_path;
+}
+
+std::optional<DriverSettings> ConfigStore::Load()
+{
+    std::ifstream file(m_path);
+
+    if (!file)
+    {
+        m_logger->info("No config file at {}", m_path);
+        return std::nullopt;
+    }
+
+    std::stringstream contents;
+    contents << file.rdbuf();
+
+    auto settings = Parse(contents.str());
+
+    if (settings)
+    {
+        std::lock_guard lock(m_mutex);
+        m_lastKnown = settings;
+    }
+
+    return settings;
+}
+
+bool ConfigStore::Save(const DriverSettings& settings)
+{
+    std::lock_guard lock(m_mutex);
+
+    if (m_lastKnown == settings)
+        return true;
+
+    std::error_code ec;
+    std::filesystem::create_directories(m_directory, ec);
+
+    if (ec)
+    {
+        m_logger->error("Unable to create config directory {}: {}", m_directory, ec.message());
+        return false;
+    }
+
+    // Write a sibling temp file and rename it over the original so readers never see a partial file
+    const std::string tempPath = m_path + ".tmp";
+    const int fd = open(tempPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+
+    if (fd < 0)
+    {
+        m_logger->error("Unable to open {}: {}", tempPath, strerror(errno));
+        return false;
+    }
+
+    if (!WriteAll(fd, Serialise(settings)) || fsync(fd) != 0)
+    {
+        m_logger->error("Unable to write {}: {}", tempPath, strerror(errno));
+        close(fd);
+        unlink(tempPath.c_str());
+        return false;
+    }
+
+    close(fd);
+
+    if (rename(tempPath.c_str(), m_path.c_str()) != 0)
+    {
+        m_logger->error("Unable to replace {}: {}", m_path, strerror(errno));
+        unlink(tempPath.c_str());
+        return false;
+    }
+
+    if (const int dirFd = open(m_directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC); dirFd >= 0)
+    {
+        fsync(dirFd);
+        close(dirFd);
+    }
+
+    m_lastKnown = settings;
+    m_logger->debug("Saved config to {}", m_path);
+    return true;
+}
+
+void ConfigStore::RequestSave(const DriverSettings& settings)
+{
+    {
+        std::lock_guard lock(m_saveMutex);
+        m_pendingSave = settings;
+    }
+
+    m_saveCondition.notify_one();
+}
+
+bool ConfigStore::StartWatching(std::function<void(const DriverSettings&)> onChange)
+{
+    if (m_isWatching)
+        return true;
+
+    std::error_code ec;
+    std::filesystem::create_directories(m_directory, ec);
+
+    m_inotifyFd = inotify_init1(IN_CLOEXEC | IN_NONBLOCK);
+
+    if (m_inotifyFd < 0)
+    {
+        m_logger->error("Unable to initialise inotify: {}", strerror(errno));
+        return false;
+    }
+
+    // Watch the directory rather than the file: atomic saves replace the inode, which would
+    // silently drop a watch placed on the file itself
+    if (inotify_add_watch(m_inotifyFd, m_directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0)
+    {
+        m_logger->error("Unable to watch {}: {}", m_directory, strerror(errno));
+        close(m_inotifyFd);
+        m_inotifyFd = -1;
+        return false;
+    }
+
+    m_wakeFd = eventfd(0, EFD_CLOEXEC);
+
+    if (m_wakeFd < 0)
+    {
+        m_logger->error("Unable to create eventfd: {}", strerror(errno));
+        close(m_inotifyFd);
+        m_inotifyFd = -1;
+        return false;
+    }
+
+    m_onChange = std::move(onChange);
+    m_isWatching = true;
+    m_watchThread = std::thread(&ConfigStore::WatchLoop, this);
+
+    m_logger->info("Watching {} for changes", m_path);
+    return true;
+}
+
+void ConfigStore::StopWatching()
+{
+    if (!m_isWatching)
+        return;
+
+    m_isWatching = false;
+
+    constexpr uint64_t wake = 1;
+    if (write(m_wakeFd, &wake, sizeof(wake)) < 0)
+        m_logger->warn("Failed to wake config watcher: {}", strerror(errno));
+
+    if (m_watchThread.joinable())
+        m_watchThread.join();
+
+    close(m_inotifyFd);
+    close(m_wakeFd);
+    m_inotifyFd = -1;
+    m_wakeFd = -1;
+}
+
+void ConfigStore::WatchLoop()
+{
+    alignas(inotify_event) char buffer[4096];
+
+    while (m_isWatching)
+    {
+        pollfd fds[2] = {{m_inotifyFd, POLLIN, 0}, {m_wakeFd, POLLIN, 0}};
+
+        if (poll(fds, 2, -1) < 0)
+        {
+            if (errno == EINTR)
+                continue;
+
+            m_logger->error("Error polling config watcher: {}", strerror(errno));
+            break;
+        }
+
+        if (!m_isWatching)
+            break;
+
+        bool isConfigTouched = false;
+        ssize_t bytesRead;
+
+        while ((bytesRead = read(m_inotifyFd, buffer, sizeof(buffer))) > 0)
+        {
+            for (ssize_t offset = 0; offset < bytesRead;)
+            {
+                const auto* event = reinterpret_cast<const inotify_event*>(buffer + offset);
+
+                if (event->len > 0 && m_fileName == event->name)
+                    isConfigTouched = true;
+
+                offset += static_cast<ssize_t>(sizeof(inotify_event) + event->len);
+            }
+        }
+
+        if (!isConfigTouched)
+            continue;
+
+        std::optional<DriverSettings> previous;
+        {
+            std::lock_guard lock(m_mutex);
+            previous = m_lastKnown;
+        }
+
+        const auto settings = Load();
+
+        if (!settings)
+        {
+            m_logger->warn("Ignoring the change to {}, keeping the current settings", m_path);
+            continue;
+        }
+
+        if (settings != previous)
+        {
+            m_logger->info("Config file {} changed, reloading", m_path);
+
+            // The edit is newer than anything still waiting to be written, so don't clobber it
+            {
+                std::lock_guard lock(m_saveMutex);
+                m_pendingSave.reset();
+            }
+
+            m_onChange(*settings);
+        }
+    }
+}
+
+void ConfigStore::SaveLoop()
+{
+    std::unique_lock lock(m_saveMutex);
+
+    while (true)
+    {
+        m_saveCondition.wait(lock, [this] { return m_pendingSave || m_isClosing; });
+
+        if (!m_pendingSave)
+            break;
+
+        // Let the burst settle; every change that arrives meanwhile just replaces m_pendingSave
+        m_saveCondition.wait_for(lock, m_saveDelay, [this] { return m_isClosing; });
+
+        if (!m_pendingSave)
+            continue;
+
+        const DriverSettings settings = *std::exchange(m_pendingSave, std::nullopt);
+
+        lock.unlock();
+        Save(settings);
+        lock.lock();
+    }
+}
+
+std::optional<DriverSettings> ConfigStore::Parse(const std::string& contents) const
+{
+    // Any line that can't be read rejects the whole file. Half-applying it would reset everything
+    // after the damage to defaults, and the next save would make that permanent.
+    DriverSettings settings;
+    std::set<std::string> seenKeys;
+    std::istringstream stream(contents);
+    std::string line;
+    int lineNumber = 0;
+
+    while (std::getline(stream, line))
+    {
+        ++lineNumber;
+        line = Trim(line.substr(0, line.find('#')));
+
+        if (line.empty())
+            continue;
+
+        const auto separator = line.find('=');
+
+        if (separator == std::string::npos)
+        {
+            m_logger->error("{}:{}: expected key = value, got '{}'", m_path, lineNumber, line);
+            return std::nullopt;
+        }
+
+        const std::string key = Trim(line.substr(0, separator));
+        const std::string value = Trim(line.substr(separator + 1));
+
+        try
+        {
+            if (key == "port")
+            {
+                settings.serialPort = value;
+            }
+            else if (key == "count")
+            {
+                settings.ledCount = std::clamp(ParseInt(value), 0, 255);
+            }
+            else if (key == "baud")
+            {
+                settings.baudRate = ParseInt(value);
+            }
+            else if (key == "color")
+            {
+                int r, g, b;
+                std::istringstream components(value);
+
+                if (!(components >> r >> g >> b) || !(components >> std::ws).eof())
+                    throw std::invalid_argument("expected three components");
+
+                if (std::min({r, g, b}) < 0 || std::max({r, g, b}) > 255)
+                    throw std::invalid_argument("components must be between 0 and 255");
+
+                settings.fillColor = ColorRGB(r, g, b);
+            }
+            else if (key == "order")
+            {
+                const auto order = openskydimo::pixels::ParseColorOrder(value);
+
+                if (!order)
+                    throw std::invalid_argument("expected one of rgb, rbg, grb, gbr, brg, bgr");
+
+                settings.colorOrder = *order;
+            }
+            else if (key == "connect")
+            {
+                if (value == "true" || value == "1" || value == "yes")
+                    settings.connect = true;
+                else if (value == "false" || value == "0" || value == "no")
+                    settings.connect = false;
+                else
+                    throw std::invalid_argument("expected true or false");
+            }
+            else
+            {
+                m_logger->error("{}:{}: unknown key '{}'", m_path, lineNumber, key);
+                return std::nullopt;
+            }
+        }
+        catch (const std::exception& e)
+        {
+            m_logger->error("{}:{}: invalid value for '{}': {}", m_path, lineNumber, key, e.what());
+            return std::nullopt;
+        }
+
+        seenKeys.insert(key);
+    }
+
+    for (const auto key : s_requiredKeys)
+    {
+        if (!seenKeys.contains(std::string(key)))
+        {
+            m_logger->error("{}: missing '{}', the file looks truncated", m_path, key);
+            return std::nullopt;
+        }
+    }
+
+    return settings;
+}
+
+std::string ConfigStore::Serialise(const DriverSettings& settings)
+{
+    std::string out = "# OpenSkydimo daemon configuration, rewritten whenever settings change\n";
+
+    out += fmt::format("port = {}\n", settings.serialPort);
+    out += fmt::format("count = {}\n", settings.ledCount);
+    out += fmt::format("baud = {}\n", settings.baudRate);
+    out += fmt::format("order = {}\n", openskydimo::pixels::ToString(settings.colorOrder));
+
+    if (settings.fillColor)
+    {
+        out += fmt::format("color = {} {} {}\n", static_cast<int>(settings.fillColor->r),
+                           static_cast<int>(settings.fillColor->g), static_cast<int>(settings.fillColor->b));
+    }
+
+    out += fmt::format("connect = {}\n", settings.connect);
+    return out;
+}
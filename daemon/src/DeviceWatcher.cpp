@@ -0,0 +1,136 @@
+#include "DeviceWatcher.h"
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+DeviceWatcher::DeviceWatcher()
+{
+    m_inotifyFd = inotify_init1(IN_CLOEXEC | IN_NONBLOCK);
+
+    if (m_inotifyFd < 0)
+        m_logger->warn("Unable to initialise inotify, falling back to polling: {}", strerror(errno));
+
+    m_wakeFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+
+    if (m_wakeFd < 0)
+        m_logger->error("Unable to create eventfd: {}", strerror(errno));
+}
+
+DeviceWatcher::~DeviceWatcher()
+{
+    if (m_inotifyFd >= 0)
+        close(m_inotifyFd);
+
+    if (m_wakeFd >= 0)
+        close(m_wakeFd);
+}
+
+bool DeviceWatcher::Watch(const std::string& devicePath)
+{
+    if (m_inotifyFd < 0)
+        return false;
+
+    std::error_code ec;
+    std::filesystem::path directory = std::filesystem::path(devicePath).parent_path();
+
+    while (!directory.empty() && !std::filesystem::is_directory(directory, ec))
+        directory = directory.parent_path();
+
+    if (directory.empty())
+        directory = "/";
+
+    if (directory == m_watchedDirectory && m_watchDescriptor >= 0)
+        return true;
+
+    Unwatch();
+
+    m_watchDescriptor = inotify_add_watch(m_inotifyFd, directory.c_str(),
+                                          IN_CREATE | IN_MOVED_TO | IN_ATTRIB | IN_DELETE_SELF);
+
+    if (m_watchDescriptor < 0)
+    {
+        m_logger->warn("Unable to watch {}: {}", directory.string(), strerror(errno));
+        return false;
+    }
+
+    m_watchedDirectory = directory.string();
+    m_logger->debug("Watching {} for {}", m_watchedDirectory, devicePath);
+    return true;
+}
+
+void DeviceWatcher::Unwatch()
+{
+    if (m_watchDescriptor >= 0)
+        inotify_rm_watch(m_inotifyFd, m_watchDescriptor);
+
+    m_watchDescriptor = -1;
+    m_watchedDirectory.clear();
+}
+
+DeviceWatcher::WaitResult DeviceWatcher::Wait(const std::chrono::milliseconds timeout, const int hangupFd)
+{
+    // POLLHUP and POLLERR are always reported, so the device needs no requested events
+    pollfd fds[3] = {{m_wakeFd, POLLIN, 0}, {hangupFd, 0, 0}, {m_inotifyFd, POLLIN, 0}};
+    const nfds_t fdCount = m_watchDescriptor >= 0 ? 3 : 2;
+
+    int ready;
+
+    do
+    {
+        ready = poll(fds, fdCount, static_cast<int>(timeout.count()));
+    } while (ready < 0 && errno == EINTR);
+
+    if (ready <= 0)
+        return WaitResult::TimedOut;
+
+    if (fds[0].revents & POLLIN)
+    {
+        uint64_t count;
+        while (read(m_wakeFd, &count, sizeof(count)) > 0)
+        {
+        }
+
+        return WaitResult::Interrupted;
+    }
+
+    if (fds[1].revents & (POLLHUP | POLLERR))
+        return WaitResult::HungUp;
+
+    if (!(fds[2].revents & POLLIN))
+        return WaitResult::TimedOut;
+
+    // Any event is reason enough to retry; drain them all so the next Wait() blocks again
+    alignas(inotify_event) char buffer[4096];
+    bool isWatchGone = false;
+    ssize_t bytesRead;
+
+    while ((bytesRead = read(m_inotifyFd, buffer, sizeof(buffer))) > 0)
+    {
+        for (ssize_t offset = 0; offset < bytesRead;)
+        {
+            const auto* event = reinterpret_cast<const inotify_event*>(buffer + offset);
+            isWatchGone |= (event->mask & (IN_DELETE_SELF | IN_IGNORED)) != 0;
+            offset += static_cast<ssize_t>(sizeof(inotify_event) + event->len);
+        }
+    }
+
+    if (isWatchGone)
+    {
+        m_watchDescriptor = -1;
+        m_watchedDirectory.clear();
+    }
+
+    return WaitResult::Changed;
+}
+
+void DeviceWatcher::Interrupt()
+{
+    constexpr uint64_t wake = 1;
+    [[maybe_unused]] const ssize_t written = write(m_wakeFd, &wake, sizeof(wake));
+}
@@ -0,0 +1,243 @@
+#include "FrameRecorder.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace openskydimo::capture;
+
+namespace
+{
+
+bool WriteAll(const int fd, const std::byte* data, size_t size)
+{
+    while (size > 0)
+    {
+        const ssize_t written = write(fd, data, size);
+
+        if (written < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+
+        data += written;
+        size -= static_cast<size_t>(written);
+    }
+
+    return true;
+}
+
+template <typename T>
+void AppendBytes(std::vector<std::byte>& out, const T& value)
+{
+    const auto* bytes = reinterpret_cast<const std::byte*>(&value);
+    out.insert(out.end(), bytes, bytes + sizeof(T));
+}
+
+} // namespace
+
+FrameRecorder::~FrameRecorder()
+{
+    Stop();
+}
+
+bool FrameRecorder::Start(const std::string& path)
+{
+    if (m_isRecording)
+    {
+        m_logger->error("Already recording to {}", m_path);
+        return false;
+    }
+
+    // Read back as well as written: the index is built from the records when the recording stops
+    m_fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+
+    if (m_fd < 0)
+    {
+        m_logger->error("Unable to open capture file {}: {}", path, strerror(errno));
+        return false;
+    }
+
+    m_path = path;
+    m_header = CaptureHeader{};
+    m_header.startTimeUnixNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                   std::chrono::system_clock::now().time_since_epoch())
+                                   .count();
+
+    m_pending.clear();
+    m_pending.reserve(m_flushThreshold + sizeof(FrameRecordHeader) + m_maxPayloadSize);
+    m_pendingIndex.clear();
+    m_pendingIndex.reserve(m_indexBatchSize);
+    AppendBytes(m_pending, m_header);
+    m_fileOffset = m_pending.size();
+
+    m_writeIndex = 0;
+    m_readIndex = 0;
+    m_droppedFrames = 0;
+    m_startTime = std::chrono::steady_clock::now();
+    m_isRecording = true;
+    m_writerThread = std::thread(&FrameRecorder::WriterLoop, this);
+
+    m_logger->info("Recording frames to {}", m_path);
+    return true;
+}
+
+void FrameRecorder::Stop()
+{
+    if (!m_isRecording)
+        return;
+
+    m_isRecording = false;
+    m_wakeups.fetch_add(1, std::memory_order_release);
+    m_wakeups.notify_one();
+
+    if (m_writerThread.joinable())
+        m_writerThread.join();
+
+    Finalise();
+
+    m_logger->info("Stopped recording to {}: {} frames, {} dropped", m_path, m_header.frameCount,
+                   m_droppedFrames.load());
+}
+
+bool FrameRecorder::IsRecording() const
+{
+    return m_isRecording;
+}
+
+void FrameRecorder::Push(const std::span<const std::byte> payload)
+{
+    const uint64_t writeIndex = m_writeIndex.load(std::memory_order_relaxed);
+
+    if (writeIndex - m_readIndex.load(std::memory_order_acquire) >= m_slotCount ||
+        payload.size() > m_maxPayloadSize)
+    {
+        m_droppedFrames.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    Slot& slot = m_slots[writeIndex % m_slotCount];
+    slot.timestampNs =
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m_startTime).count();
+    slot.payloadSize = static_cast<uint32_t>(payload.size());
+    std::ranges::copy(payload, slot.payload.begin());
+
+    m_writeIndex.store(writeIndex + 1, std::memory_order_release);
+    m_wakeups.fetch_add(1, std::memory_order_release);
+    m_wakeups.notify_one();
+}
+
+void FrameRecorder::WriterLoop()
+{
+    bool ok = true;
+
+    while (ok)
+    {
+        const uint32_t wakeups = m_wakeups.load(std::memory_order_acquire);
+        const uint64_t writeIndex = m_writeIndex.load(std::memory_order_acquire);
+        uint64_t readIndex = m_readIndex.load(std::memory_order_relaxed);
+
+        while (ok && readIndex < writeIndex)
+        {
+            ok = WriteSlot(readIndex % m_slotCount);
+            m_readIndex.store(++readIndex, std::memory_order_release);
+        }
+
+        if (!m_isRecording)
+            break;
+
+        // Batch small frames into larger writes, but never sit on data while idle
+        if (ok && !m_pending.empty() && m_writeIndex.load(std::memory_order_acquire) == readIndex)
+            ok = Flush();
+
+        m_wakeups.wait(wakeups, std::memory_order_acquire);
+    }
+
+    if (ok)
+        Flush();
+}
+
+bool FrameRecorder::WriteSlot(const size_t slotIndex)
+{
+    const Slot& slot = m_slots[slotIndex];
+
+    ++m_header.frameCount;
+
+    AppendBytes(m_pending, FrameRecordHeader{slot.timestampNs, slot.payloadSize, 0});
+    m_pending.insert(m_pending.end(), slot.payload.begin(), slot.payload.begin() + slot.payloadSize);
+    m_fileOffset += sizeof(FrameRecordHeader) + slot.payloadSize;
+
+    if (m_pending.size() >= m_flushThreshold)
+        return Flush();
+
+    return true;
+}
+
+bool FrameRecorder::Flush()
+{
+    if (m_pending.empty())
+        return true;
+
+    if (!WriteAll(m_fd, m_pending.data(), m_pending.size()))
+    {
+        m_logger->error("Failed to write capture file {}: {}", m_path, strerror(errno));
+        return false;
+    }
+
+    m_pending.clear();
+    return true;
+}
+
+bool FrameRecorder::WriteIndex()
+{
+    // A second sequential pass over the records just written, so the index never has to be held in
+    // memory: only one batch of entries is buffered at a time and appended after the records
+    const auto flushIndex = [this] {
+        const auto* bytes = reinterpret_cast<const std::byte*>(m_pendingIndex.data());
+        const bool ok = WriteAll(m_fd, bytes, m_pendingIndex.size() * sizeof(CaptureIndexEntry));
+        m_pendingIndex.clear();
+        return ok;
+    };
+
+    uint64_t offset = sizeof(CaptureHeader);
+
+    while (offset < m_fileOffset)
+    {
+        FrameRecordHeader record;
+
+        if (pread(m_fd, &record, sizeof(record), static_cast<off_t>(offset)) != static_cast<ssize_t>(sizeof(record)))
+            return false;
+
+        m_pendingIndex.push_back({record.timestampNs, offset});
+        offset += sizeof(FrameRecordHeader) + record.payloadSize;
+
+        if (m_pendingIndex.size() == m_indexBatchSize && !flushIndex())
+            return false;
+    }
+
+    return flushIndex();
+}
+
+void FrameRecorder::Finalise()
+{
+    if (m_fd < 0)
+        return;
+
+    // Without an index the capture is still readable up to EOF, so only point at a complete one
+    if (WriteIndex())
+        m_header.indexOffset = m_fileOffset;
+    else
+        m_logger->error("Failed to write the index of capture file {}: {}", m_path, strerror(errno));
+
+    const auto* headerBytes = reinterpret_cast<const std::byte*>(&m_header);
+
+    if (pwrite(m_fd, headerBytes, sizeof(m_header), 0) != static_cast<ssize_t>(sizeof(m_header)))
+        m_logger->error("Failed to finalise capture file {}: {}", m_path, strerror(errno));
+
+    close(m_fd);
+    m_fd = -1;
+}
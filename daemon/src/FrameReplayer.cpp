@@ -0,0 +1,192 @@
+#include "FrameReplayer.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utility>
+
+#include "FrameCapture.h"
+
+using namespace openskydimo::capture;
+
+namespace
+{
+
+// Sleep slices are capped so that Stop() is honoured promptly even across long gaps in a capture
+constexpr int64_t s_maxSleepNs = 50'000'000;
+// The final stretch before a deadline is spun rather than slept, absorbing timer-wakeup latency
+constexpr int64_t s_spinNs = 200'000;
+constexpr int64_t s_nsPerSecond = 1'000'000'000;
+
+int64_t MonotonicNowNs()
+{
+    timespec ts{};
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * s_nsPerSecond + ts.tv_nsec;
+}
+
+void SleepUntilNs(const int64_t deadlineNs)
+{
+    const timespec ts{static_cast<time_t>(deadlineNs / s_nsPerSecond), static_cast<long>(deadlineNs % s_nsPerSecond)};
+
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr) == EINTR)
+    {
+    }
+}
+
+template <typename T>
+T ReadAt(const std::byte* data, const size_t offset)
+{
+    T value;
+    std::memcpy(&value, data + offset, sizeof(T));
+    return value;
+}
+
+} // namespace
+
+FrameReplayer::FrameReplayer(FrameSink sink) : m_sink(std::move(sink))
+{
+}
+
+FrameReplayer::~FrameReplayer()
+{
+    Stop();
+}
+
+bool FrameReplayer::Start(const std::string& path, const double rate)
+{
+    Stop();
+
+    if (rate <= 0.0)
+    {
+        m_logger->error("Replay rate must be positive, got {}", rate);
+        return false;
+    }
+
+    const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+
+    if (fd < 0)
+    {
+        m_logger->error("Unable to open capture file {}: {}", path, strerror(errno));
+        return false;
+    }
+
+    struct stat st{};
+
+    if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(CaptureHeader))
+    {
+        m_logger->error("Capture file {} is truncated", path);
+        close(fd);
+        return false;
+    }
+
+    void* mapping = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if (mapping == MAP_FAILED)
+    {
+        m_logger->error("Unable to map capture file {}: {}", path, strerror(errno));
+        return false;
+    }
+
+    m_data = static_cast<const std::byte*>(mapping);
+    m_size = static_cast<size_t>(st.st_size);
+    madvise(mapping, m_size, MADV_SEQUENTIAL);
+
+    if (const auto header = ReadAt<CaptureHeader>(m_data, 0); header.magic != s_magic || header.version != s_version)
+    {
+        m_logger->error("{} is not a supported capture file", path);
+        Unmap();
+        return false;
+    }
+
+    m_path = path;
+    m_rate = rate;
+    m_isReplaying = true;
+    m_replayThread = std::thread(&FrameReplayer::ReplayLoop, this);
+
+    m_logger->info("Replaying {} at {}x", m_path, m_rate);
+    return true;
+}
+
+void FrameReplayer::Stop()
+{
+    m_isReplaying = false;
+
+    if (m_replayThread.joinable())
+        m_replayThread.join();
+
+    Unmap();
+}
+
+bool FrameReplayer::IsReplaying() const
+{
+    return m_isReplaying;
+}
+
+void FrameReplayer::ReplayLoop()
+{
+    const auto header = ReadAt<CaptureHeader>(m_data, 0);
+
+    // A finalised capture ends its records where the index begins; an unfinalised one runs to EOF
+    const bool hasIndex = header.indexOffset >= sizeof(CaptureHeader) && header.indexOffset <= m_size;
+    const size_t recordsEnd = hasIndex ? header.indexOffset : m_size;
+
+    const int64_t startNs = MonotonicNowNs();
+    size_t offset = sizeof(CaptureHeader);
+    uint64_t frames = 0;
+    int64_t worstLateNs = 0;
+
+    while (m_isReplaying && offset + sizeof(FrameRecordHeader) <= recordsEnd)
+    {
+        const auto record = ReadAt<FrameRecordHeader>(m_data, offset);
+        offset += sizeof(FrameRecordHeader);
+
+        if (offset + record.payloadSize > recordsEnd)
+        {
+            m_logger->warn("Capture {} ends with a truncated frame", m_path);
+            break;
+        }
+
+        // Deadlines are absolute from the start of playback so that error never accumulates
+        const int64_t deadlineNs = startNs + static_cast<int64_t>(static_cast<double>(record.timestampNs) / m_rate);
+
+        const int64_t wakeNs = deadlineNs - s_spinNs;
+
+        for (int64_t nowNs = MonotonicNowNs(); m_isReplaying && nowNs < wakeNs; nowNs = MonotonicNowNs())
+            SleepUntilNs(std::min(wakeNs, nowNs + s_maxSleepNs));
+
+        while (MonotonicNowNs() < deadlineNs)
+        {
+        }
+
+        if (!m_isReplaying)
+            break;
+
+        worstLateNs = std::max(worstLateNs, MonotonicNowNs() - deadlineNs);
+
+        m_sink(std::span(m_data + offset, record.payloadSize));
+
+        offset += record.payloadSize;
+        ++frames;
+    }
+
+    m_logger->info("Replay of {} finished: {} frames, worst lateness {:.3f} ms", m_path, frames,
+                   static_cast<double>(worstLateNs) / 1e6);
+    m_isReplaying = false;
+}
+
+void FrameReplayer::Unmap()
+{
+    if (m_data != nullptr)
+    {
+        munmap(const_cast<std::byte*>(m_data), m_size);
+        m_data = nullptr;
+        m_size = 0;
+    }
+}
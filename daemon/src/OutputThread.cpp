@@ -0,0 +1,182 @@
+#include "OutputThread.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <utility>
+
+namespace
+{
+
+constexpr long s_nsPerSecond = 1'000'000'000;
+
+const char* PolicyName(const int policy)
+{
+    switch (policy)
+    {
+    case SCHED_FIFO:
+        return "SCHED_FIFO";
+    case SCHED_RR:
+        return "SCHED_RR";
+    case SCHED_OTHER:
+        return "SCHED_OTHER";
+    default:
+        return "unknown";
+    }
+}
+
+void AddNs(timespec& ts, const long ns)
+{
+    ts.tv_nsec += ns;
+
+    while (ts.tv_nsec >= s_nsPerSecond)
+    {
+        ts.tv_nsec -= s_nsPerSecond;
+        ++ts.tv_sec;
+    }
+}
+
+} // namespace
+
+OutputThread::OutputThread(SkydimoDriver& driver, OutputThreadOptions options)
+    : m_driver(driver), m_options(std::move(options))
+{
+}
+
+OutputThread::~OutputThread()
+{
+    Stop();
+}
+
+void OutputThread::Start()
+{
+    if (m_isRunning)
+        return;
+
+    // Locking memory affects the whole process, so it has to happen before the thread starts
+    // touching its stack and the driver's buffers
+    bool isMemoryLocked = false;
+
+    if (m_options.lockMemory)
+    {
+        if (mlockall(MCL_CURRENT | MCL_FUTURE) == 0)
+            isMemoryLocked = true;
+        else
+            m_logger->warn("mlockall failed, continuing with pageable memory: {}", strerror(errno));
+    }
+
+    m_isRunning = true;
+    m_thread = std::thread(&OutputThread::OutputLoop, this);
+    m_isScheduled.acquire();
+
+    if (isMemoryLocked)
+        m_schedulingReport += ", memory locked";
+
+    m_logger->info("Output thread running every {} ms ({})", m_options.interval.count(), m_schedulingReport);
+}
+
+void OutputThread::Stop()
+{
+    if (!m_isRunning)
+        return;
+
+    m_isRunning = false;
+
+    if (m_thread.joinable())
+        m_thread.join();
+}
+
+const std::string& OutputThread::GetSchedulingReport() const
+{
+    return m_schedulingReport;
+}
+
+void OutputThread::ApplyScheduling()
+{
+    const pthread_t handle = pthread_self();
+
+    int policy = SCHED_OTHER;
+
+    if (m_options.policy == "fifo")
+        policy = SCHED_FIFO;
+    else if (m_options.policy == "rr")
+        policy = SCHED_RR;
+
+    if (policy != SCHED_OTHER)
+    {
+        sched_param param{};
+        param.sched_priority =
+            std::clamp(m_options.priority, sched_get_priority_min(policy), sched_get_priority_max(policy));
+
+        if (const int error = pthread_setschedparam(handle, policy, &param); error != 0)
+        {
+            m_logger->warn("Unable to set {} priority {}, staying on the default policy: {}", PolicyName(policy),
+                           param.sched_priority, strerror(error));
+        }
+    }
+
+    if (m_options.cpu >= 0)
+    {
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(m_options.cpu, &cpus);
+
+        if (const int error = pthread_setaffinity_np(handle, sizeof(cpus), &cpus); error != 0)
+            m_logger->warn("Unable to pin output thread to CPU {}: {}", m_options.cpu, strerror(error));
+    }
+
+    // Report what the kernel actually granted rather than what was asked for
+    int actualPolicy = SCHED_OTHER;
+    sched_param actualParam{};
+    pthread_getschedparam(handle, &actualPolicy, &actualParam);
+
+    m_schedulingReport = fmt::format("{} priority {}", PolicyName(actualPolicy), actualParam.sched_priority);
+
+    cpu_set_t actualCpus;
+    CPU_ZERO(&actualCpus);
+
+    if (pthread_getaffinity_np(handle, sizeof(actualCpus), &actualCpus) == 0 && CPU_COUNT(&actualCpus) == 1)
+    {
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+        {
+            if (CPU_ISSET(cpu, &actualCpus))
+                m_schedulingReport += fmt::format(", pinned to CPU {}", cpu);
+        }
+    }
+}
+
+void OutputThread::OutputLoop()
+{
+    // Switch policy before the first frame so none of them goes out at the default priority
+    ApplyScheduling();
+    m_isScheduled.release();
+
+    const long intervalNs = std::chrono::duration_cast<std::chrono::nanoseconds>(m_options.interval).count();
+
+    timespec next{};
+    clock_gettime(CLOCK_MONOTONIC, &next);
+
+    // Steady state is just SendColors and an absolute sleep: no allocation and no logging here
+    while (m_isRunning)
+    {
+        if (m_driver.IsReadyToSend())
+            m_driver.SendColors();
+
+        AddNs(next, intervalNs);
+
+        // After a long stall, start a fresh schedule instead of sending a burst of catch-up frames
+        timespec now{};
+        clock_gettime(CLOCK_MONOTONIC, &now);
+
+        if (now.tv_sec > next.tv_sec + 1)
+            next = now;
+
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, nullptr) == EINTR)
+        {
+        }
+    }
+}
@@ -1,13 +1,30 @@
 #include "SkydimoDriver.h"
 
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
 #include <fcntl.h>
 #include <iostream>
 #include <termios.h>
 #include <unistd.h>
+#include <utility>
+
+SkydimoDriver::SkydimoDriver() : m_reconnectThread(&SkydimoDriver::ReconnectLoop, this)
+{
+}
 
 SkydimoDriver::~SkydimoDriver()
 {
-    std::lock_guard lock(m_mutex);
+    {
+        std::lock_guard lock(m_mutex);
+        m_isShuttingDown = true;
+        m_deviceWatcher.Interrupt();
+    }
+
+    if (m_reconnectThread.joinable())
+        m_reconnectThread.join();
+
+    std::lock_guard lock(m_sendMutex);
     if (m_serialPort >= 0)
     {
         close(m_serialPort);
@@ -30,14 +47,228 @@ void SkydimoDriver::SetBaudRate(const int baudRate)
 void SkydimoDriver::SetLedCount(const int ledCount)
 {
     std::lock_guard lock(m_mutex);
-    m_ledCount = ledCount;
-    AddHeaderToBuffer();
+    SetLedCountLocked(ledCount);
+}
+
+void SkydimoDriver::SetColorOrder(const openskydimo::pixels::ColorOrder colorOrder)
+{
+    std::lock_guard lock(m_mutex);
+    SetColorOrderLocked(colorOrder);
 }
 
 bool SkydimoDriver::OpenSerialConnection()
+{
+    std::string portName;
+    int baudRate;
+    {
+        std::lock_guard lock(m_mutex);
+
+        if (!RequestConnectionLocked())
+            return false;
+
+        if (m_isReadyToSend)
+            return true;
+
+        portName = m_portName;
+        baudRate = m_baudRate;
+    }
+
+    return ConnectPort(portName, baudRate);
+}
+
+void SkydimoDriver::CloseSerialConnection()
+{
+    std::lock_guard lock(m_mutex);
+    CloseSerialConnectionLocked();
+}
+
+DriverSettings SkydimoDriver::GetSettings() const
+{
+    std::lock_guard lock(m_mutex);
+    return {m_portName, m_ledCount, m_baudRate, m_fillColor, m_shouldBeConnected, m_colorOrder};
+}
+
+void SkydimoDriver::ApplySettings(const DriverSettings& settings)
+{
+    std::string portName;
+    int baudRate;
+    bool shouldConnect;
+    {
+        // Held for the whole apply, so a command can never land between two of its steps
+        std::lock_guard lock(m_mutex);
+
+        // The port has to be reopened for a new device or baud rate to take effect
+        const bool isLinkChanged = settings.serialPort != m_portName || settings.baudRate != m_baudRate;
+
+        if (m_shouldBeConnected && (isLinkChanged || !settings.connect))
+            CloseSerialConnectionLocked();
+
+        m_portName = settings.serialPort;
+        m_baudRate = settings.baudRate;
+
+        if (settings.ledCount != m_ledCount)
+            SetLedCountLocked(settings.ledCount);
+
+        if (settings.colorOrder != m_colorOrder)
+            SetColorOrderLocked(settings.colorOrder);
+
+        // Only a new fill color is applied, so a reload doesn't wipe a frame image shown since the last fill
+        if (settings.fillColor && settings.fillColor != m_fillColor)
+            FillLocked(*settings.fillColor);
+
+        shouldConnect = settings.connect && !m_isReadyToSend && RequestConnectionLocked();
+        portName = m_portName;
+        baudRate = m_baudRate;
+    }
+
+    // Only the blocking open happens outside the lock. InstallPort drops the port if a command
+    // closed or retargeted the connection in the meantime.
+    if (shouldConnect)
+        ConnectPort(portName, baudRate);
+}
+
+bool SkydimoDriver::IsReadyToSend() const
+{
+    return m_isReadyToSend;
+}
+
+bool SkydimoDriver::SendColors()
+{
+    std::lock_guard lock(m_sendMutex);
+
+    // This runs on the output thread every tick, so the success paths stay free of logging
+    if (!m_isReadyToSend)
+        return false;
+
+    m_frames.Update();
+    const Frame& frame = m_frames.Front();
+    bool isComplete = false;
+
+    if (const ssize_t bytesWritten = write(m_serialPort, frame.data.data(), frame.size); bytesWritten < 0)
+    {
+        if (errno == EIO || errno == ENXIO || errno == ENODEV || errno == EPIPE)
+            HandleDisconnect(strerror(errno));
+        else
+            logger->error("Failed to write to serial port {}: {} (errno: {})", m_connectedPortName, strerror(errno),
+                          errno);
+    }
+    else if (static_cast<size_t>(bytesWritten) != frame.size)
+    {
+        logger->warn("Incomplete write to {}: {}/{} bytes", m_connectedPortName, bytesWritten, frame.size);
+    }
+    else
+    {
+        isComplete = true;
+    }
+
+    if (m_isRecording && frame.size >= m_headerSize)
+        m_recorder.Push(std::span(frame.data).first(frame.size).subspan(m_headerSize));
+
+    return isComplete;
+}
+
+void SkydimoDriver::Fill(const ColorRGB color)
+{
+    std::lock_guard lock(m_mutex);
+    FillLocked(color);
+}
+
+void SkydimoDriver::SetPixels(const openskydimo::pixels::PixelFormat format, const std::span<const std::byte> pixels)
 {
     std::lock_guard lock(m_mutex);
 
+    if (m_buffer.size() < m_headerSize)
+    {
+        logger->error("Insufficient buffer size");
+        return;
+    }
+
+    const size_t count = std::min(pixels.size() / openskydimo::pixels::BytesPerPixel(format),
+                                  (m_buffer.size() - m_headerSize) / 3);
+
+    openskydimo::pixels::ConvertPixels(format, m_colorOrder, pixels.data(), m_buffer.data() + m_headerSize, count);
+    PublishBuffer();
+}
+
+void SkydimoDriver::SetColors(const std::span<const std::byte> colors)
+{
+    std::lock_guard lock(m_mutex);
+
+    if (m_buffer.size() < m_headerSize)
+    {
+        logger->error("Insufficient buffer size");
+        return;
+    }
+
+    const size_t count = std::min(colors.size(), m_buffer.size() - m_headerSize);
+    std::copy_n(colors.begin(), count, m_buffer.begin() + m_headerSize);
+    PublishBuffer();
+}
+
+bool SkydimoDriver::StartRecording(const std::string& path)
+{
+    StopRecording();
+
+    // Opening the capture file happens outside the lock so SendColors is never held up by it
+    if (!m_recorder.Start(path))
+        return false;
+
+    std::lock_guard lock(m_sendMutex);
+    m_isRecording = true;
+    return true;
+}
+
+void SkydimoDriver::StopRecording()
+{
+    {
+        std::lock_guard lock(m_sendMutex);
+        m_isRecording = false;
+    }
+
+    // No SendColors can be pushing once the flag is cleared, so the writer can be drained unlocked
+    m_recorder.Stop();
+}
+
+bool SkydimoDriver::IsRecording() const
+{
+    return m_recorder.IsRecording();
+}
+
+void SkydimoDriver::SetLedCountLocked(const int ledCount)
+{
+    // Caller holds m_mutex
+    m_ledCount = std::clamp(ledCount, 0, m_maxLedCount);
+    AddHeaderToBuffer();
+    PublishBuffer();
+}
+
+void SkydimoDriver::SetColorOrderLocked(const openskydimo::pixels::ColorOrder colorOrder)
+{
+    // Caller holds m_mutex
+    const auto previousOrder = std::exchange(m_colorOrder, colorOrder);
+
+    if (m_buffer.size() < m_headerSize)
+        return;
+
+    // The buffer holds bytes in the old order. Permuting them keeps a frame image intact, where
+    // re-filling would wipe it; for a fill the result is the same.
+    openskydimo::pixels::ReorderWire(previousOrder, colorOrder, m_buffer.data() + m_headerSize,
+                                     (m_buffer.size() - m_headerSize) / 3);
+    PublishBuffer();
+}
+
+void SkydimoDriver::FillLocked(const ColorRGB color)
+{
+    // Caller holds m_mutex
+    logger->debug("Filling {} LEDs with RGB{}", m_ledCount, color);
+    m_fillColor = color;
+    FillBuffer(color);
+    PublishBuffer();
+}
+
+bool SkydimoDriver::RequestConnectionLocked()
+{
+    // Caller holds m_mutex
     logger->info("Opening serial port {}", m_portName);
 
     if (m_portName.empty())
@@ -52,22 +283,69 @@ bool SkydimoDriver::OpenSerialConnection()
         return false;
     }
 
-    m_serialPort = open(m_portName.c_str(), O_RDWR | O_NOCTTY);
+    // From here on the driver keeps trying to reach the port until CloseSerialConnection()
+    m_shouldBeConnected = true;
+    return true;
+}
 
-    if (m_serialPort < 0)
+void SkydimoDriver::CloseSerialConnectionLocked()
+{
+    // Caller holds m_mutex
+    logger->info("Closing serial port {}", m_portName);
     {
-        logger->error("Unable to open serial port {}", m_portName);
+        std::lock_guard sendLock(m_sendMutex);
+
+        if (m_serialPort >= 0)
+        {
+            close(m_serialPort);
+            m_serialPort = -1;
+        }
+
+        m_isReadyToSend = false;
+    }
+
+    m_shouldBeConnected = false;
+    m_deviceWatcher.Interrupt();
+}
+
+bool SkydimoDriver::ConnectPort(const std::string& portName, const int baudRate)
+{
+    // Opening and configuring the tty can block, so it is done without holding up SendColors
+    const int fd = OpenPort(portName, baudRate, spdlog::level::err);
+
+    if (fd < 0)
+    {
+        {
+            std::lock_guard lock(m_sendMutex);
+            m_disconnectTime = std::chrono::steady_clock::now();
+        }
+
+        logger->warn("Waiting for {} to become available", portName);
+        m_deviceWatcher.Interrupt();
         return false;
     }
 
+    return InstallPort(fd, portName);
+}
+
+int SkydimoDriver::OpenPort(const std::string& portName, const int baudRate,
+                           const spdlog::level::level_enum failureLevel) const
+{
+    const int fd = open(portName.c_str(), O_RDWR | O_NOCTTY | O_CLOEXEC);
+
+    if (fd < 0)
+    {
+        logger->log(failureLevel, "Unable to open serial port {}: {}", portName, strerror(errno));
+        return -1;
+    }
+
     termios tty{};
 
-    if (tcgetattr(m_serialPort, &tty) != 0)
+    if (tcgetattr(fd, &tty) != 0)
     {
-        logger->error("Unable to get tty attributes");
-        close(m_serialPort);
-        m_serialPort = -1;
-        return false;
+        logger->log(failureLevel, "Unable to get tty attributes for {}", portName);
+        close(fd);
+        return -1;
     }
 
     // Configure basic settings
@@ -95,116 +373,217 @@ bool SkydimoDriver::OpenSerialConnection()
     tty.c_cc[VTIME] = 10; // 1 second timeout (in deciseconds)
     tty.c_cc[VMIN] = 0;   // Return immediately with available data
 
-    // Set baud rate (convert m_baudRate to speed_t)
-    speed_t baudRate;
-    switch (m_baudRate)
+    // Set baud rate (convert baudRate to speed_t)
+    speed_t speed;
+    switch (baudRate)
     {
     case 9600:
-        baudRate = B9600;
+        speed = B9600;
         break;
     case 19200:
-        baudRate = B19200;
+        speed = B19200;
         break;
     case 38400:
-        baudRate = B38400;
+        speed = B38400;
         break;
     case 57600:
-        baudRate = B57600;
+        speed = B57600;
         break;
     case 115200:
-        baudRate = B115200;
+        speed = B115200;
         break;
     case 230400:
-        baudRate = B230400;
+        speed = B230400;
         break;
     default:
-        logger->error("Unsupported baud rate: {}", m_baudRate);
-        close(m_serialPort);
-        m_serialPort = -1;
-        return false;
+        logger->error("Unsupported baud rate: {}", baudRate);
+        close(fd);
+        return -1;
     }
 
-    cfsetispeed(&tty, baudRate);
-    cfsetospeed(&tty, baudRate);
+    cfsetispeed(&tty, speed);
+    cfsetospeed(&tty, speed);
 
     // Apply settings
-    if (tcsetattr(m_serialPort, TCSANOW, &tty) != 0)
+    if (tcsetattr(fd, TCSANOW, &tty) != 0)
     {
-        logger->error("Unable to set tty attributes");
-        close(m_serialPort);
-        m_serialPort = -1;
-        return false;
+        logger->log(failureLevel, "Unable to set tty attributes for {}", portName);
+        close(fd);
+        return -1;
     }
 
-    m_isReadyToSend = true;
-    return true;
+    return fd;
 }
 
-void SkydimoDriver::CloseSerialConnection()
+bool SkydimoDriver::InstallPort(const int fd, const std::string& portName)
 {
     std::lock_guard lock(m_mutex);
+    std::lock_guard sendLock(m_sendMutex);
 
-    logger->info("Closing serial port {}", m_portName);
-    if (m_serialPort >= 0)
+    // The port may have been closed, changed or reopened by another thread while this one was opening
+    if (!m_shouldBeConnected || m_isReadyToSend || portName != m_portName)
     {
-        close(m_serialPort);
-        m_serialPort = -1;
+        close(fd);
+        return m_isReadyToSend;
     }
 
-    m_isReadyToSend = false;
+    m_serialPort = fd;
+    m_connectedPortName = portName;
+    m_isReadyToSend = true;
+    m_connectTime = std::chrono::steady_clock::now();
+    ++m_connectionCount;
+
+    // Wake the reconnect thread so it starts watching the new port for a hangup
+    m_deviceWatcher.Interrupt();
+    return true;
 }
 
-bool SkydimoDriver::IsReadyToSend() const
+void SkydimoDriver::HandleDisconnect(const char* reason)
 {
-    std::lock_guard lock(m_mutex);
-    return m_isReadyToSend;
+    // Caller holds m_sendMutex
+    logger->warn("Serial port {} disconnected: {}", m_connectedPortName, reason);
+
+    close(m_serialPort);
+    m_serialPort = -1;
+    m_isReadyToSend = false;
+    m_disconnectTime = std::chrono::steady_clock::now();
+    m_deviceWatcher.Interrupt();
 }
 
-void SkydimoDriver::SendColors() const
+void SkydimoDriver::ReconnectLoop()
 {
-    std::lock_guard lock(m_mutex);
+    auto backoff = m_minReconnectBackoff;
+    auto retryTime = std::chrono::steady_clock::time_point();
+    uint64_t handledConnectionCount = 0;
 
-    if (!m_isReadyToSend)
-    {
-        logger->debug("Not ready to send colors");
-        return;
-    }
-
-    if (const ssize_t bytesWritten = write(m_serialPort, m_buffer.data(), m_buffer.size()); bytesWritten < 0)
+    while (true)
     {
-        logger->error("Failed to write to serial port {}: {} (errno: {})", m_portName, strerror(errno), errno);
-    }
-    else if (static_cast<size_t>(bytesWritten) != m_buffer.size())
-    {
-        logger->warn("Incomplete write to {}: {}/{} bytes", m_portName, bytesWritten, m_buffer.size());
-    }
-    else
-    {
-        logger->debug("Sent {} bytes to {}", bytesWritten, m_portName);
+        std::string portName;
+        int baudRate;
+        bool isWaitingForDevice;
+        bool wasStable;
+        std::chrono::steady_clock::time_point disconnectTime;
+        int hangupFd = -1;
+        uint64_t connectionCount;
+        {
+            std::lock_guard lock(m_mutex);
+
+            if (m_isShuttingDown)
+                break;
+
+            isWaitingForDevice = m_shouldBeConnected && !m_isReadyToSend && !m_portName.empty();
+            portName = m_portName;
+            baudRate = m_baudRate;
+
+            std::lock_guard sendLock(m_sendMutex);
+            connectionCount = m_connectionCount;
+            disconnectTime = m_disconnectTime;
+            // A disconnect older than the last connect means the port was closed on purpose
+            wasStable = m_disconnectTime < m_connectTime || m_disconnectTime - m_connectTime >= m_minStableUptime;
+
+            // Poll a duplicate so the descriptor can't be closed and reused underneath the wait
+            if (m_isReadyToSend)
+                hangupFd = fcntl(m_serialPort, F_DUPFD_CLOEXEC, 0);
+        }
+
+        if (!isWaitingForDevice)
+        {
+            m_deviceWatcher.Unwatch();
+            const auto result = m_deviceWatcher.Wait(std::chrono::milliseconds(-1), hangupFd);
+
+            if (hangupFd >= 0)
+                close(hangupFd);
+
+            // An idle port is never written to, so without this an unplug would go unnoticed
+            // until the next frame
+            if (result == DeviceWatcher::WaitResult::HungUp)
+            {
+                std::lock_guard lock(m_sendMutex);
+
+                if (m_isReadyToSend && m_connectionCount == connectionCount)
+                    HandleDisconnect("hung up");
+            }
+
+            continue;
+        }
+
+        // Decided once per lost connection: a port that stayed up starts over from the shortest
+        // backoff, while one that dropped straight after opening waits before it is reopened, so a
+        // flapping device can't make this loop spin
+        if (connectionCount != handledConnectionCount)
+        {
+            handledConnectionCount = connectionCount;
+
+            if (wasStable)
+            {
+                backoff = m_minReconnectBackoff;
+            }
+            else
+            {
+                retryTime = disconnectTime + backoff;
+                backoff = std::min(backoff * 2, m_maxReconnectBackoff);
+            }
+        }
+
+        if (const auto now = std::chrono::steady_clock::now(); now < retryTime)
+        {
+            m_deviceWatcher.Wait(std::chrono::duration_cast<std::chrono::milliseconds>(retryTime - now) +
+                                 std::chrono::milliseconds(1));
+            continue;
+        }
+
+        // Watch before trying to open so a device appearing in between is not missed
+        m_deviceWatcher.Watch(portName);
+
+        if (const int fd = OpenPort(portName, baudRate, spdlog::level::debug); fd >= 0)
+        {
+            if (InstallPort(fd, portName))
+            {
+                std::lock_guard lock(m_sendMutex);
+                const std::chrono::duration<double, std::milli> downtime =
+                    std::chrono::steady_clock::now() - m_disconnectTime;
+                logger->info("Reconnected to {} after {:.0f} ms", portName, downtime.count());
+            }
+
+            continue;
+        }
+
+        // A change next to the device path is worth an immediate retry; otherwise back off. Only a
+        // connection that stays up resets the backoff.
+        if (m_deviceWatcher.Wait(backoff) != DeviceWatcher::WaitResult::Changed)
+            backoff = std::min(backoff * 2, m_maxReconnectBackoff);
     }
 }
 
-void SkydimoDriver::Fill(const ColorRGB color)
+void SkydimoDriver::FillBuffer(const ColorRGB color)
 {
-    std::lock_guard lock(m_mutex);
-    logger->debug("Filling {} LEDs with RGB{}", m_ledCount, color);
-
-    if (m_buffer.size() < (m_headerSize + m_ledCount * 3))
+    // Caller holds m_mutex
+    if (m_buffer.size() < static_cast<size_t>(m_headerSize + m_ledCount * 3))
     {
         logger->error("Insufficient buffer size");
         return;
     }
 
+    const auto wire = openskydimo::pixels::ToWireOrder(m_colorOrder, color);
     int offset = m_headerSize;
 
     for (int i = 0; i < m_ledCount; i++)
     {
-        m_buffer[offset++] = color.r;
-        m_buffer[offset++] = color.g;
-        m_buffer[offset++] = color.b;
+        m_buffer[offset++] = wire[0];
+        m_buffer[offset++] = wire[1];
+        m_buffer[offset++] = wire[2];
     }
 }
 
+void SkydimoDriver::PublishBuffer()
+{
+    // Caller holds m_mutex, which makes it the only producer
+    Frame& frame = m_frames.Back();
+    frame.size = std::min(m_buffer.size(), frame.data.size());
+    std::copy_n(m_buffer.begin(), frame.size, frame.data.begin());
+    m_frames.Publish();
+}
+
 void SkydimoDriver::AddHeaderToBuffer()
 {
     // Note: This is a private method called only from SetLedCount,
@@ -3,12 +3,15 @@
 #include <csignal>
 #include <thread>
 
+#include "CLI/CLI.hpp"
 #include "spdlog/sinks/stdout_color_sinks.h"
 #include "spdlog/spdlog.h"
 
 #include "openskydimo/config.h"
 
 #include "CommandsListener.h"
+#include "ConfigStore.h"
+#include "OutputThread.h"
 #include "SkydimoDriver.h"
 
 static std::atomic shutdown_requested{false};
@@ -22,14 +25,68 @@ void SignalHandler(const int signal)
         shutdown_requested.store(true, std::memory_order_release);
 }
 
-int main()
+int main(const int argc, char* argv[])
 {
+    const auto startupTime = std::chrono::steady_clock::now();
+
     const std::shared_ptr<spdlog::logger> logger =
         spdlog::get("Daemon") ? spdlog::get("Daemon") : spdlog::stdout_color_mt("Daemon");
 
+    CLI::App app{"OpenSkydimo LED daemon"};
+    argv = app.ensure_utf8(argv);
+
+    std::string configPath = ConfigStore::DefaultPath();
+    app.add_option("-c,--config", configPath, "Settings file to restore at startup and keep up to date")
+        ->capture_default_str();
+
+    bool isConfigReadOnly = false;
+    app.add_flag("--read-only-config", isConfigReadOnly,
+                 "Restore settings from the config file but never write changes back, e.g. while load testing");
+
+    OutputThreadOptions outputOptions;
+    int frameIntervalMs = static_cast<int>(outputOptions.interval.count());
+    app.add_option("--rt-policy", outputOptions.policy, "Scheduling policy for the output thread")
+        ->check(CLI::IsMember({"other", "fifo", "rr"}))
+        ->capture_default_str();
+    app.add_option("--rt-priority", outputOptions.priority, "Real-time priority for the fifo and rr policies")
+        ->check(CLI::Range(1, 99));
+    app.add_option("--cpu", outputOptions.cpu, "Pin the output thread to this CPU")->check(CLI::NonNegativeNumber);
+    app.add_flag("--mlock", outputOptions.lockMemory, "Lock all daemon memory to avoid page faults on output");
+    app.add_option("--frame-interval", frameIntervalMs, "Milliseconds between frames sent to the LEDs")
+        ->check(CLI::Range(1, 10000))
+        ->capture_default_str();
+
+    CLI11_PARSE(app, argc, argv);
+    outputOptions.interval = std::chrono::milliseconds(frameIntervalMs);
+
     SkydimoDriver driver;
+    ConfigStore config(configPath);
+
+    // Restore the previous session before anything else so the strip lights up straight away
+    if (const auto settings = config.Load())
+    {
+        driver.ApplySettings(*settings);
+
+        if (driver.SendColors())
+        {
+            const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - startupTime;
+            logger->info("First frame sent {:.2f} ms after startup", elapsed.count());
+        }
+    }
+
+    // Frames go out on their own (optionally real-time) thread; the control socket keeps a normal one
+    OutputThread outputThread(driver, outputOptions);
+    outputThread.Start();
+
     CommandsListener listener(s_socketPath, driver);
 
+    // The listener only queues the settings; ConfigStore writes them from its own thread
+    if (!isConfigReadOnly)
+        listener.SetCommandExecutedCallback([&] { config.RequestSave(driver.GetSettings()); });
+
+    listener.SetStatusCallback([&] { return "output=\"" + outputThread.GetSchedulingReport() + "\""; });
+    config.StartWatching([&](const DriverSettings& settings) { driver.ApplySettings(settings); });
+
     struct sigaction signalAction{};
     signalAction.sa_handler = SignalHandler;
     sigemptyset(&signalAction.sa_mask);
@@ -50,12 +107,7 @@ int main()
     listener.Start();
 
     while (!listener.ShouldStop() && !shutdown_requested.load(std::memory_order_acquire))
-    {
-        if (driver.IsReadyToSend())
-            driver.SendColors();
-
         std::this_thread::sleep_for(std::chrono::milliseconds(100));
-    }
 
     // Trigger graceful shutdown if signal was received
     if (shutdown_requested.load(std::memory_order_acquire))
@@ -63,5 +115,8 @@ int main()
         listener.Stop();
     }
 
+    outputThread.Stop();
+    config.StopWatching();
+
     return 0;
 }
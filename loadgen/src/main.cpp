@@ -0,0 +1,237 @@
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "CLI/CLI.hpp"
+#include "spdlog/fmt/bundled/format.h"
+
+#include "openskydimo/client.hpp"
+#include "openskydimo/config.h"
+#include "openskydimo/stats.hpp"
+
+using Clock = std::chrono::steady_clock;
+using openskydimo::stats::Percentile;
+
+// Unthrottled clients pause this long after a failed connect instead of hammering the listen queue
+constexpr auto s_connectRetryDelay = std::chrono::milliseconds(10);
+// How long past the end of the run a command may still take before it counts as timed out. A
+// stalled daemon therefore delays the report by this much at most.
+constexpr auto s_responseGrace = std::chrono::seconds(1);
+
+struct LoadOptions
+{
+    std::string socketPath = s_socketPath;
+    int clients = 8;
+    double rate = 0.0; // Total commands per second across all clients, 0 for as fast as possible
+    double durationSeconds = 10.0;
+    bool reuseConnections = false;
+    int ledCount = 60;
+    int fillWeight = 70;
+    int setWeight = 10;
+    int startWeight = 10;
+    int stopWeight = 10;
+};
+
+struct ClientStats
+{
+    std::vector<double> latenciesMs;
+    size_t sent = 0;
+    size_t errors = 0;     // Daemon answered with ERROR
+    size_t refused = 0;    // connect() was refused
+    size_t timeouts = 0;   // Still waiting to connect or for a response when the run was over
+    size_t ioFailures = 0; // Connection dropped without a response
+};
+
+std::string MakeCommand(const int kind, const LoadOptions& options, std::mt19937& rng)
+{
+    std::uniform_int_distribution channel(0, 255);
+
+    switch (kind)
+    {
+    case 0:
+        return fmt::format("fill {} {} {}", channel(rng), channel(rng), channel(rng));
+    case 1:
+        return fmt::format("set count {}", options.ledCount);
+    case 2:
+        return "start";
+    default:
+        return "stop";
+    }
+}
+
+// Each client runs its own schedule at rate / clients. Latency is measured from when a command was
+// due rather than when it was actually sent, so a stalled server shows up as latency instead of
+// silently lowering the offered load.
+void RunClient(const LoadOptions& options, const unsigned seed, const Clock::time_point startTime,
+               const Clock::time_point endTime, ClientStats& stats)
+{
+    std::mt19937 rng(seed);
+    std::discrete_distribution<int> commandKind(
+        {static_cast<double>(options.fillWeight), static_cast<double>(options.setWeight),
+         static_cast<double>(options.startWeight), static_cast<double>(options.stopWeight)});
+
+    const double clientRate = options.rate / options.clients;
+    const auto deadline = endTime + s_responseGrace;
+    openskydimo::client::Connection connection;
+    std::string response;
+
+    std::this_thread::sleep_until(startTime);
+
+    for (size_t i = 0;; ++i)
+    {
+        Clock::time_point dueTime = Clock::now();
+
+        if (clientRate > 0.0)
+        {
+            const auto offset = std::chrono::duration<double>(static_cast<double>(i) / clientRate);
+            dueTime = startTime + std::chrono::duration_cast<Clock::duration>(offset);
+            std::this_thread::sleep_until(dueTime);
+        }
+
+        if (dueTime >= endTime)
+            break;
+
+        // A daemon that stopped accepting would otherwise hold connect() until its backlog drains
+        const auto sendTimeout = std::chrono::ceil<std::chrono::milliseconds>(deadline - Clock::now());
+
+        if (!connection.IsConnected() && !connection.Connect(options.socketPath, sendTimeout))
+        {
+            const int error = connection.GetErrno();
+            ++(error == ECONNREFUSED ? stats.refused : error == EAGAIN ? stats.timeouts : stats.ioFailures);
+            ++stats.sent;
+
+            if (clientRate <= 0.0)
+                std::this_thread::sleep_for(s_connectRetryDelay);
+
+            continue;
+        }
+
+        ++stats.sent;
+
+        // A late response would be mistaken for the next command's, so a timed-out connection is dropped
+        if (!connection.SendLine(MakeCommand(commandKind(rng), options, rng)) ||
+            !connection.ReadLine(response, deadline))
+        {
+            const int error = connection.GetErrno();
+            ++(error == ETIMEDOUT || error == EAGAIN ? stats.timeouts : stats.ioFailures);
+            connection.Close();
+            continue;
+        }
+
+        stats.latenciesMs.push_back(std::chrono::duration<double, std::milli>(Clock::now() - dueTime).count());
+
+        if (response.starts_with("ERROR"))
+            ++stats.errors;
+
+        if (!options.reuseConnections)
+            connection.Close();
+    }
+}
+
+int main(const int argc, char* argv[])
+{
+    CLI::App app{"Generates concurrent load against the OpenSkydimo control socket and reports latency. Start the "
+                 "daemon with --read-only-config so the generated settings don't end up in its config file."};
+    argv = app.ensure_utf8(argv);
+
+    LoadOptions options;
+    app.add_option("-s,--socket", options.socketPath, "Control socket path")->capture_default_str();
+    app.add_option("-c,--clients", options.clients, "Number of concurrent clients")
+        ->check(CLI::Range(1, 10000))
+        ->capture_default_str();
+    app.add_option("-r,--rate", options.rate, "Target commands per second across all clients (0 = unthrottled)")
+        ->check(CLI::NonNegativeNumber)
+        ->capture_default_str();
+    app.add_option("-d,--duration", options.durationSeconds, "Test duration in seconds")
+        ->check(CLI::PositiveNumber)
+        ->capture_default_str();
+    app.add_flag("--reuse-connections", options.reuseConnections,
+                 "Keep one connection per client instead of connecting for every command like the CLI");
+    app.add_option("--led-count", options.ledCount, "LED count sent by 'set count' commands")
+        ->check(CLI::Range(1, 255))
+        ->capture_default_str();
+    app.add_option("--fill", options.fillWeight, "Relative weight of 'fill' commands")
+        ->check(CLI::NonNegativeNumber)
+        ->capture_default_str();
+    app.add_option("--set", options.setWeight, "Relative weight of 'set count' commands")
+        ->check(CLI::NonNegativeNumber)
+        ->capture_default_str();
+    app.add_option("--start", options.startWeight, "Relative weight of 'start' commands")
+        ->check(CLI::NonNegativeNumber)
+        ->capture_default_str();
+    app.add_option("--stop", options.stopWeight, "Relative weight of 'stop' commands")
+        ->check(CLI::NonNegativeNumber)
+        ->capture_default_str();
+
+    CLI11_PARSE(app, argc, argv);
+
+    if (options.fillWeight + options.setWeight + options.startWeight + options.stopWeight == 0)
+    {
+        std::cerr << "At least one command weight must be non-zero" << std::endl;
+        return 1;
+    }
+
+    std::cerr << fmt::format("{} clients, {}, {:.1f} s, {} against {}\n", options.clients,
+                             options.rate > 0.0 ? fmt::format("{:.0f} commands/s", options.rate) : "unthrottled",
+                             options.durationSeconds,
+                             options.reuseConnections ? "persistent connections" : "one connection per command",
+                             options.socketPath);
+
+    std::vector<ClientStats> stats(static_cast<size_t>(options.clients));
+    std::vector<std::thread> clients;
+
+    // Give every thread a moment to spin up so they all start on the same schedule
+    const auto startTime = Clock::now() + std::chrono::milliseconds(50);
+    const auto endTime =
+        startTime + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(options.durationSeconds));
+
+    std::random_device seeder;
+
+    for (size_t i = 0; i < stats.size(); ++i)
+    {
+        clients.emplace_back(RunClient, std::cref(options), seeder(), startTime, endTime, std::ref(stats[i]));
+    }
+
+    for (auto& client : clients)
+        client.join();
+
+    const double elapsedSeconds = std::chrono::duration<double>(Clock::now() - startTime).count();
+
+    ClientStats total;
+
+    for (const auto& clientStats : stats)
+    {
+        total.latenciesMs.insert(total.latenciesMs.end(), clientStats.latenciesMs.begin(),
+                                 clientStats.latenciesMs.end());
+        total.sent += clientStats.sent;
+        total.errors += clientStats.errors;
+        total.refused += clientStats.refused;
+        total.timeouts += clientStats.timeouts;
+        total.ioFailures += clientStats.ioFailures;
+    }
+
+    std::ranges::sort(total.latenciesMs);
+
+    std::cout << fmt::format("attempted   {} ({:.0f}/s)\n", total.sent,
+                             static_cast<double>(total.sent) / elapsedSeconds);
+    std::cout << fmt::format("completed   {} ({:.0f}/s)\n", total.latenciesMs.size(),
+                             static_cast<double>(total.latenciesMs.size()) / elapsedSeconds);
+    std::cout << fmt::format("errors      {}\n", total.errors);
+    std::cout << fmt::format("refused     {}\n", total.refused);
+    std::cout << fmt::format("timed out   {}\n", total.timeouts);
+    std::cout << fmt::format("io failures {}\n", total.ioFailures);
+
+    if (!total.latenciesMs.empty())
+    {
+        std::cout << fmt::format("latency ms  p50 {:.3f}  p99 {:.3f}  p999 {:.3f}  max {:.3f}\n",
+                                 Percentile(total.latenciesMs, 0.50), Percentile(total.latenciesMs, 0.99),
+                                 Percentile(total.latenciesMs, 0.999), total.latenciesMs.back());
+    }
+
+    return total.errors == 0 && total.refused == 0 && total.timeouts == 0 && total.ioFailures == 0 ? 0 : 1;
+}
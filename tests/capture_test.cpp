@@ -0,0 +1,328 @@
+// Records frames with FrameRecorder and plays them back with FrameReplayer into a fake sink that
+// keeps every frame and when it arrived, so the capture format and the replay timing can be
+// checked without a serial port.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <mutex>
+#include <span>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "FrameCapture.h"
+#include "FrameRecorder.h"
+#include "FrameReplayer.h"
+
+using namespace openskydimo::capture;
+using Clock = std::chrono::steady_clock;
+
+namespace
+{
+
+constexpr size_t s_roundTripFrames = 200; // Fewer than the recorder's ring, so none can be dropped
+constexpr size_t s_timingFrames = 300;
+constexpr int64_t s_timingIntervalNs = 2'000'000;
+constexpr int64_t s_maxLatenessNs = 1'000'000;
+constexpr auto s_spin = std::chrono::microseconds(200); // Same margin as the replayer
+constexpr auto s_timeout = std::chrono::seconds(5);
+constexpr int s_skipReturnCode = 77;
+
+int s_failures = 0;
+bool s_isTimingSkipped = false;
+
+void Expect(const bool condition, const char* what)
+{
+    if (!condition)
+    {
+        std::fprintf(stderr, "FAILED: %s\n", what);
+        ++s_failures;
+    }
+}
+
+struct ReceivedFrame
+{
+    std::vector<std::byte> payload;
+    Clock::time_point arrival;
+};
+
+// Stands in for the driver: stores each frame as the replay thread hands it over
+class FakeSink
+{
+public:
+    FrameReplayer::FrameSink Callback()
+    {
+        return [this](const std::span<const std::byte> colors) {
+            const auto arrival = Clock::now();
+            std::lock_guard lock(m_mutex);
+            m_frames.push_back({std::vector(colors.begin(), colors.end()), arrival});
+        };
+    }
+
+    std::vector<ReceivedFrame> Frames()
+    {
+        std::lock_guard lock(m_mutex);
+        return m_frames;
+    }
+
+private:
+    std::mutex m_mutex;
+    std::vector<ReceivedFrame> m_frames;
+};
+
+std::vector<std::byte> ReadFile(const std::string& path)
+{
+    std::ifstream file(path, std::ios::binary);
+    std::vector<char> contents{std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+    const auto* bytes = reinterpret_cast<const std::byte*>(contents.data());
+    return {bytes, bytes + contents.size()};
+}
+
+void WriteFile(const std::string& path, const std::vector<std::byte>& contents)
+{
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char*>(contents.data()), static_cast<std::streamsize>(contents.size()));
+}
+
+template <typename T>
+T ReadAt(const std::vector<std::byte>& data, const size_t offset)
+{
+    T value;
+    std::copy_n(data.begin() + static_cast<std::ptrdiff_t>(offset), sizeof(T), reinterpret_cast<std::byte*>(&value));
+    return value;
+}
+
+template <typename T>
+void Append(std::vector<std::byte>& out, const T& value)
+{
+    const auto* bytes = reinterpret_cast<const std::byte*>(&value);
+    out.insert(out.end(), bytes, bytes + sizeof(T));
+}
+
+std::vector<std::byte> Payload(const size_t frame)
+{
+    // Sizes vary so that a record boundary read from the wrong place shows up as a mismatch
+    std::vector<std::byte> payload(3 + (frame % 40) * 3);
+
+    for (size_t i = 0; i < payload.size(); ++i)
+        payload[i] = static_cast<std::byte>(frame * 7 + i);
+
+    return payload;
+}
+
+// Replays a capture at the given rate and returns what the sink received
+std::vector<ReceivedFrame> Replay(const std::string& path, const double rate, bool& isStarted)
+{
+    FakeSink sink;
+    FrameReplayer replayer(sink.Callback());
+    isStarted = replayer.Start(path, rate);
+
+    const auto deadline = Clock::now() + s_timeout;
+
+    while (replayer.IsReplaying() && Clock::now() < deadline)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+    Expect(!replayer.IsReplaying(), "replay finishes");
+    replayer.Stop();
+    return sink.Frames();
+}
+
+void TestRoundTrip(const std::string& path)
+{
+    {
+        FrameRecorder recorder;
+        Expect(recorder.Start(path), "start recording");
+        Expect(recorder.IsRecording(), "report recording");
+
+        for (size_t frame = 0; frame < s_roundTripFrames; ++frame)
+            recorder.Push(Payload(frame));
+
+        recorder.Stop();
+        Expect(!recorder.IsRecording(), "report stopped");
+    }
+
+    const auto contents = ReadFile(path);
+    const auto header = ReadAt<CaptureHeader>(contents, 0);
+
+    Expect(header.magic == s_magic && header.version == s_version, "write a valid header");
+    Expect(header.frameCount == s_roundTripFrames, "count every frame in the header");
+    Expect(header.indexOffset + header.frameCount * sizeof(CaptureIndexEntry) == contents.size(),
+           "end the file with one index entry per frame");
+
+    // The index points at each record in order, and timestamps never go backwards
+    int64_t previousTimestampNs = 0;
+
+    for (size_t frame = 0; frame < header.frameCount; ++frame)
+    {
+        const auto entry = ReadAt<CaptureIndexEntry>(contents, header.indexOffset + frame * sizeof(CaptureIndexEntry));
+        const auto record = ReadAt<FrameRecordHeader>(contents, entry.recordOffset);
+
+        Expect(record.timestampNs == entry.timestampNs, "index timestamps match the records");
+        Expect(record.payloadSize == Payload(frame).size(), "index offsets point at the right records");
+        Expect(record.timestampNs >= previousTimestampNs, "timestamps are monotonic");
+        previousTimestampNs = record.timestampNs;
+    }
+
+    bool isStarted = false;
+    const auto frames = Replay(path, 1.0, isStarted);
+
+    Expect(isStarted, "start replaying");
+    Expect(frames.size() == s_roundTripFrames, "replay every recorded frame");
+
+    for (size_t frame = 0; frame < std::min(frames.size(), s_roundTripFrames); ++frame)
+        Expect(frames[frame].payload == Payload(frame), "replay each payload byte for byte");
+}
+
+void TestRejectsDamagedCaptures(const std::string& path)
+{
+    const auto contents = ReadFile(path);
+    const auto header = ReadAt<CaptureHeader>(contents, 0);
+    bool isStarted = true;
+
+    WriteFile(path, {contents.begin(), contents.begin() + sizeof(CaptureHeader) - 1});
+    Replay(path, 1.0, isStarted);
+    Expect(!isStarted, "reject a file shorter than the header");
+
+    auto badMagic = contents;
+    badMagic[0] = std::byte{'X'};
+    WriteFile(path, badMagic);
+    Replay(path, 1.0, isStarted);
+    Expect(!isStarted, "reject a bad magic");
+
+    auto badVersion = contents;
+    badVersion[sizeof(s_magic)] = static_cast<std::byte>(s_version + 1);
+    WriteFile(path, badVersion);
+    Replay(path, 1.0, isStarted);
+    Expect(!isStarted, "reject an unknown version");
+
+    // Cut the last record short. The header still points at an index past EOF, so the replayer has
+    // to fall back to EOF and stop at the last complete frame.
+    const auto lastEntry =
+        ReadAt<CaptureIndexEntry>(contents, header.indexOffset + (header.frameCount - 1) * sizeof(CaptureIndexEntry));
+    WriteFile(path, {contents.begin(), contents.begin() + static_cast<std::ptrdiff_t>(lastEntry.recordOffset) + 20});
+
+    const auto frames = Replay(path, 1.0, isStarted);
+    Expect(isStarted, "replay a truncated capture");
+    Expect(frames.size() == header.frameCount - 1, "drop only the truncated frame");
+}
+
+// Worst lateness of a plain sleep-then-spin loop over the same deadlines. No replayer can beat the
+// host's own scheduling, so on a loaded or single-CPU machine the timing bound is not checked.
+int64_t MeasureHostLatenessNs()
+{
+    const auto start = Clock::now();
+    int64_t worstLatenessNs = 0;
+
+    for (size_t frame = 0; frame < s_timingFrames; ++frame)
+    {
+        const auto due = start + std::chrono::nanoseconds(static_cast<int64_t>(frame) * s_timingIntervalNs);
+        std::this_thread::sleep_until(due - s_spin);
+
+        while (Clock::now() < due)
+        {
+        }
+
+        const int64_t latenessNs = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - due).count();
+        worstLatenessNs = std::max(worstLatenessNs, latenessNs);
+    }
+
+    return worstLatenessNs;
+}
+
+void TestReplayTiming(const std::string& path)
+{
+    // Written by hand so that the timestamps are exact rather than whatever recording produced
+    std::vector<std::byte> contents;
+    CaptureHeader header;
+    header.frameCount = s_timingFrames;
+    Append(contents, header);
+
+    const std::vector<std::byte> payload(30);
+
+    for (size_t frame = 0; frame < s_timingFrames; ++frame)
+    {
+        Append(contents, FrameRecordHeader{static_cast<int64_t>(frame) * s_timingIntervalNs,
+                                           static_cast<uint32_t>(payload.size()), 0});
+        contents.insert(contents.end(), payload.begin(), payload.end());
+    }
+
+    WriteFile(path, contents);
+
+    // Playback starts after this, so measuring from here can only overstate the lateness
+    const auto start = Clock::now();
+    bool isStarted = false;
+    const auto frames = Replay(path, 1.0, isStarted);
+
+    Expect(isStarted, "start the timed replay");
+    Expect(frames.size() == s_timingFrames, "replay every timed frame");
+
+    int64_t worstLatenessNs = 0;
+    bool isAnyEarly = false;
+
+    for (size_t frame = 0; frame < frames.size(); ++frame)
+    {
+        const auto due = start + std::chrono::nanoseconds(static_cast<int64_t>(frame) * s_timingIntervalNs);
+        const auto arrival = frames[frame].arrival;
+        const int64_t latenessNs = std::chrono::duration_cast<std::chrono::nanoseconds>(arrival - due).count();
+
+        isAnyEarly = isAnyEarly || arrival < due;
+        worstLatenessNs = std::max(worstLatenessNs, latenessNs);
+    }
+
+    std::printf("worst replay lateness %.3f ms over %zu frames\n", static_cast<double>(worstLatenessNs) / 1e6,
+                frames.size());
+
+    Expect(!isAnyEarly, "never deliver a frame before its deadline");
+
+    if (worstLatenessNs < s_maxLatenessNs)
+        return;
+
+    if (const int64_t hostLatenessNs = MeasureHostLatenessNs(); hostLatenessNs >= s_maxLatenessNs)
+    {
+        std::printf("host timers alone are up to %.3f ms late, not checking replay lateness\n",
+                    static_cast<double>(hostLatenessNs) / 1e6);
+        s_isTimingSkipped = true;
+        return;
+    }
+
+    Expect(false, "deliver every frame within 1 ms of its deadline");
+}
+
+} // namespace
+
+int main()
+{
+    spdlog::set_level(spdlog::level::err);
+
+    char directoryTemplate[] = "/tmp/openskydimo-test-XXXXXX";
+    const char* directory = mkdtemp(directoryTemplate);
+
+    if (directory == nullptr)
+    {
+        std::perror("mkdtemp");
+        return 1;
+    }
+
+    const std::string path = std::string(directory) + "/capture.oskycap";
+
+    TestRoundTrip(path);
+    TestRejectsDamagedCaptures(path);
+    TestReplayTiming(path);
+
+    unlink(path.c_str());
+    rmdir(directory);
+
+    if (s_failures != 0)
+        return 1;
+
+    if (s_isTimingSkipped)
+        return s_skipReturnCode;
+
+    std::printf("capture_test passed\n");
+    return 0;
+}
@@ -0,0 +1,199 @@
+// Checks every pixel format and color order against a plain per-pixel reference, at sizes around
+// the SIMD block edges. Source and destination sit flush against a PROT_NONE page, so a kernel
+// that loads or stores a single byte past either buffer crashes the test instead of passing.
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string_view>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "openskydimo/pixel_format.hpp"
+
+using namespace openskydimo::pixels;
+
+namespace
+{
+
+constexpr size_t s_maxPixels = 70;
+
+// A buffer of the given size ending exactly where an inaccessible page begins
+class GuardedBuffer
+{
+public:
+    explicit GuardedBuffer(const size_t size)
+    {
+        m_pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        m_mapping = mmap(nullptr, 2 * m_pageSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+        if (m_mapping == MAP_FAILED)
+        {
+            std::perror("mmap");
+            std::exit(1);
+        }
+
+        auto* base = static_cast<std::byte*>(m_mapping);
+        mprotect(base + m_pageSize, m_pageSize, PROT_NONE);
+        m_data = base + m_pageSize - size;
+    }
+
+    ~GuardedBuffer()
+    {
+        munmap(m_mapping, 2 * m_pageSize);
+    }
+
+    GuardedBuffer(const GuardedBuffer&) = delete;
+    GuardedBuffer& operator=(const GuardedBuffer&) = delete;
+
+    [[nodiscard]] std::byte* Data() const
+    {
+        return m_data;
+    }
+
+private:
+    size_t m_pageSize = 0;
+    void* m_mapping = nullptr;
+    std::byte* m_data = nullptr;
+};
+
+// Decodes one source pixel to red, green and blue without going through any of the kernels
+std::array<uint8_t, 3> ReferenceRgb(const PixelFormat format, const std::byte* pixel)
+{
+    const auto byte = [pixel](const size_t i) { return static_cast<uint8_t>(pixel[i]); };
+
+    switch (format)
+    {
+    case PixelFormat::RGB:
+    case PixelFormat::RGBA:
+        return {byte(0), byte(1), byte(2)};
+    case PixelFormat::BGR:
+    case PixelFormat::BGRA:
+        return {byte(2), byte(1), byte(0)};
+    case PixelFormat::RGB565:
+    {
+        const unsigned value = byte(0) | (byte(1) << 8);
+        const unsigned r = (value >> 11) & 0x1f;
+        const unsigned g = (value >> 5) & 0x3f;
+        const unsigned b = value & 0x1f;
+
+        // Expanded by bit replication, so 0 and full scale map to 0 and 255
+        return {static_cast<uint8_t>((r << 3) | (r >> 2)), static_cast<uint8_t>((g << 2) | (g >> 4)),
+                static_cast<uint8_t>((b << 3) | (b >> 2))};
+    }
+    }
+
+    return {};
+}
+
+// The order's name spells out which channel goes in each wire byte, e.g. "grb"
+uint8_t ReferenceWireByte(const ColorOrder order, const std::array<uint8_t, 3>& rgb, const size_t position)
+{
+    switch (ToString(order)[position])
+    {
+    case 'r':
+        return rgb[0];
+    case 'g':
+        return rgb[1];
+    default:
+        return rgb[2];
+    }
+}
+
+} // namespace
+
+int main()
+{
+    constexpr std::array formats = {PixelFormat::RGB, PixelFormat::BGR, PixelFormat::RGBA, PixelFormat::BGRA,
+                                    PixelFormat::RGB565};
+    constexpr std::array orders = {ColorOrder::RGB, ColorOrder::RBG, ColorOrder::GRB,
+                                   ColorOrder::GBR, ColorOrder::BRG, ColorOrder::BGR};
+
+    std::mt19937 rng(1234);
+    std::uniform_int_distribution<int> byteValue(0, 255);
+    int failures = 0;
+
+    for (const PixelFormat format : formats)
+    {
+        for (const ColorOrder order : orders)
+        {
+            for (size_t count = 0; count < s_maxPixels; ++count)
+            {
+                const size_t srcSize = count * BytesPerPixel(format);
+                GuardedBuffer src(srcSize);
+                GuardedBuffer dst(count * 3);
+
+                for (size_t i = 0; i < srcSize; ++i)
+                    src.Data()[i] = static_cast<std::byte>(byteValue(rng));
+
+                ConvertPixels(format, order, src.Data(), dst.Data(), count);
+
+                for (size_t pixel = 0; pixel < count; ++pixel)
+                {
+                    const auto rgb = ReferenceRgb(format, src.Data() + pixel * BytesPerPixel(format));
+
+                    for (size_t position = 0; position < 3; ++position)
+                    {
+                        const auto expected = ReferenceWireByte(order, rgb, position);
+                        const auto actual = static_cast<uint8_t>(dst.Data()[pixel * 3 + position]);
+
+                        if (actual != expected && failures++ < 20)
+                        {
+                            std::fprintf(stderr, "FAILED: %s -> %s, %zu pixels: pixel %zu byte %zu is %u, not %u\n",
+                                         ToString(format).data(), ToString(order).data(), count, pixel, position,
+                                         actual, expected);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    // Re-packing wire bytes from one order to another must match converting straight to the new order
+    for (const ColorOrder from : orders)
+    {
+        for (const ColorOrder to : orders)
+        {
+            for (size_t count = 0; count < s_maxPixels; ++count)
+            {
+                GuardedBuffer src(count * 3);
+                GuardedBuffer wire(count * 3);
+                GuardedBuffer expected(count * 3);
+
+                for (size_t i = 0; i < count * 3; ++i)
+                    src.Data()[i] = static_cast<std::byte>(byteValue(rng));
+
+                ConvertPixels(PixelFormat::RGB, from, src.Data(), wire.Data(), count);
+                ConvertPixels(PixelFormat::RGB, to, src.Data(), expected.Data(), count);
+                ReorderWire(from, to, wire.Data(), count);
+
+                for (size_t i = 0; i < count * 3; ++i)
+                {
+                    if (wire.Data()[i] != expected.Data()[i] && failures++ < 20)
+                    {
+                        std::fprintf(stderr, "FAILED: reorder %s -> %s, %zu pixels: byte %zu is %u, not %u\n",
+                                     ToString(from).data(), ToString(to).data(), count, i,
+                                     static_cast<unsigned>(wire.Data()[i]), static_cast<unsigned>(expected.Data()[i]));
+                    }
+                }
+            }
+        }
+    }
+
+    for (const PixelFormat format : formats)
+    {
+        if (ParsePixelFormat(ToString(format)) != format)
+        {
+            std::fprintf(stderr, "FAILED: %s does not round-trip through its name\n", ToString(format).data());
+            ++failures;
+        }
+    }
+
+    if (failures == 0)
+        std::printf("pixel_format_test passed\n");
+
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,230 @@
+// Runs SkydimoDriver against a pseudo-terminal standing in for the LED controller. The pty is
+// destroyed and recreated behind a stable symlink, the way a USB adapter is unplugged and plugged
+// back in under /dev/serial/by-id.
+
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <poll.h>
+#include <pty.h>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <utility>
+
+#include "SkydimoDriver.h"
+
+namespace
+{
+
+constexpr int s_ledCount = 4;
+constexpr size_t s_frameSize = 6 + s_ledCount * 3;
+constexpr auto s_timeout = std::chrono::seconds(2);
+constexpr auto s_flapDuration = std::chrono::seconds(1);
+// With the backoff doubling from 10 ms, about 7 reopens fit into a second; without it, hundreds
+constexpr int s_maxFlapReconnects = 15;
+
+int s_failures = 0;
+
+void Expect(const bool condition, const char* what)
+{
+    if (!condition)
+    {
+        std::fprintf(stderr, "FAILED: %s\n", what);
+        ++s_failures;
+    }
+}
+
+bool WaitFor(const std::function<bool()>& condition)
+{
+    const auto deadline = std::chrono::steady_clock::now() + s_timeout;
+
+    while (!condition())
+    {
+        if (std::chrono::steady_clock::now() > deadline)
+            return false;
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    return true;
+}
+
+// The controller end of the link. linkPath always names the current pty, like a by-id symlink.
+class FakeDevice
+{
+public:
+    explicit FakeDevice(std::string linkPath) : m_linkPath(std::move(linkPath))
+    {
+    }
+
+    ~FakeDevice()
+    {
+        Unplug();
+    }
+
+    bool Plug()
+    {
+        int slave;
+        char slaveName[64];
+
+        if (openpty(&m_master, &slave, slaveName, nullptr, nullptr) != 0)
+            return false;
+
+        // Only the driver should hold the slave open, as it would for real hardware
+        close(slave);
+
+        // Swap the link in with a rename so the watcher sees a single IN_MOVED_TO
+        const std::string tempLink = m_linkPath + ".new";
+        unlink(tempLink.c_str());
+        return symlink(slaveName, tempLink.c_str()) == 0 && rename(tempLink.c_str(), m_linkPath.c_str()) == 0;
+    }
+
+    void Unplug()
+    {
+        unlink(m_linkPath.c_str());
+
+        if (m_master >= 0)
+            close(m_master);
+
+        m_master = -1;
+    }
+
+    // Reads one frame's worth of bytes, or fewer if nothing more arrives in time
+    size_t ReadFrame(std::byte* frame = nullptr)
+    {
+        size_t total = 0;
+        std::byte buffer[s_frameSize];
+
+        if (frame == nullptr)
+            frame = buffer;
+
+        while (total < s_frameSize)
+        {
+            pollfd fd = {m_master, POLLIN, 0};
+
+            if (poll(&fd, 1, static_cast<int>(std::chrono::milliseconds(s_timeout).count())) <= 0)
+                break;
+
+            const ssize_t bytesRead = read(m_master, frame + total, s_frameSize - total);
+
+            if (bytesRead <= 0)
+                break;
+
+            total += static_cast<size_t>(bytesRead);
+        }
+
+        return total;
+    }
+
+private:
+    std::string m_linkPath;
+    int m_master = -1;
+};
+
+} // namespace
+
+int main()
+{
+    spdlog::set_level(spdlog::level::warn);
+
+    char directoryTemplate[] = "/tmp/openskydimo-test-XXXXXX";
+    const char* directory = mkdtemp(directoryTemplate);
+
+    if (directory == nullptr)
+    {
+        std::perror("mkdtemp");
+        return 1;
+    }
+
+    const std::string linkPath = std::string(directory) + "/ttyLED";
+
+    {
+        FakeDevice device(linkPath);
+        Expect(device.Plug(), "create pty");
+
+        SkydimoDriver driver;
+        driver.SetSerialPort(linkPath);
+        driver.SetLedCount(s_ledCount);
+        driver.Fill(ColorRGB(10, 20, 30));
+
+        Expect(driver.OpenSerialConnection(), "open the serial port");
+        Expect(driver.SendColors(), "send a frame");
+        Expect(device.ReadFrame() == s_frameSize, "receive a full frame");
+
+        // Nothing is sent while unplugged, so this is caught by the hangup check, not a failed write
+        device.Unplug();
+        Expect(WaitFor([&] { return !driver.IsReadyToSend(); }), "notice the hangup without writing");
+
+        Expect(device.Plug(), "recreate pty");
+        Expect(WaitFor([&] { return driver.IsReadyToSend(); }), "reconnect once the device is back");
+        Expect(driver.SendColors(), "send a frame after reconnecting");
+        Expect(device.ReadFrame() == s_frameSize, "receive a full frame after reconnecting");
+
+        Expect(driver.GetSettings().connect, "still want to be connected");
+
+        // An image sent as a frame must survive a change of color order, not be replaced by the fill
+        const std::array<std::byte, s_ledCount * 3> image = {
+            std::byte{1}, std::byte{2},  std::byte{3},  std::byte{4},  std::byte{5},  std::byte{6},
+            std::byte{7}, std::byte{8},  std::byte{9},  std::byte{10}, std::byte{11}, std::byte{12}};
+        driver.SetColorOrder(openskydimo::pixels::ColorOrder::RGB);
+        driver.SetColors(image);
+        driver.SetColorOrder(openskydimo::pixels::ColorOrder::BGR);
+        Expect(driver.SendColors(), "send a frame after changing the color order");
+
+        std::array<std::byte, s_frameSize> frame{};
+        Expect(device.ReadFrame(frame.data()) == s_frameSize, "receive the reordered frame");
+
+        for (size_t pixel = 0; pixel < s_ledCount; ++pixel)
+        {
+            for (size_t position = 0; position < 3; ++position)
+            {
+                Expect(frame[s_frameSize - s_ledCount * 3 + pixel * 3 + position] == image[pixel * 3 + 2 - position],
+                       "permute the frame into the new color order");
+            }
+        }
+
+        driver.CloseSerialConnection();
+        Expect(!driver.IsReadyToSend(), "close the serial port");
+    }
+
+    {
+        // A device that drops every time it is opened must not be reopened in a tight loop
+        FakeDevice device(linkPath);
+        Expect(device.Plug(), "create flapping pty");
+
+        SkydimoDriver driver;
+        driver.SetSerialPort(linkPath);
+        driver.SetLedCount(s_ledCount);
+        Expect(driver.OpenSerialConnection(), "open the flapping port");
+
+        int reconnects = 0;
+        const auto end = std::chrono::steady_clock::now() + s_flapDuration;
+
+        while (std::chrono::steady_clock::now() < end)
+        {
+            if (driver.IsReadyToSend())
+            {
+                device.Unplug();
+                device.Plug();
+                ++reconnects;
+            }
+
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        }
+
+        Expect(reconnects <= s_maxFlapReconnects, "back off from a flapping device");
+        Expect(WaitFor([&] { return driver.IsReadyToSend(); }), "still reconnect to a flapping device");
+
+        driver.CloseSerialConnection();
+    }
+
+    rmdir(directory);
+
+    if (s_failures == 0)
+        std::printf("serial_reconnect_test passed\n");
+
+    return s_failures == 0 ? 0 : 1;
+}